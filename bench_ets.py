@@ -0,0 +1,127 @@
+#!/usr/bin/env python
+"""Benchmarks for the C++ part of ETS, run through pyETS.
+
+Every benchmark is timed on the test data in data/ets_test_data.dat and on
+synthetic fields with a given number of targets distributed uniformly over
+the patrol area of the cobras. For every benchmark, the best time of several
+repetitions, the resulting throughput (in targets per second) and the peak
+memory of the process so far are printed.
+
+Examples:
+    python bench_ets.py
+    python bench_ets.py --ntgt 10000 100000 1000000 10000000 --nthreads 8
+"""
+import argparse
+import resource
+import sys
+import time
+
+import numpy as np
+import pyETS
+
+# approximate PFS plate scale in mm per degree; good enough to place the
+# test data on the focal plane without depending on pfs.utils
+PLATE_SCALE = 320.
+
+
+def readTestData(fname):
+    """Returns the focal plane positions, observation times and priorities
+    of the targets in `fname`, projected around their mean position."""
+    ra, dec, tm, pri = np.loadtxt(fname, skiprows=1, usecols=(1, 2, 3, 4),
+                                  unpack=True)
+    a0, d0 = np.deg2rad(np.mean(ra)), np.deg2rad(np.mean(dec))
+    a, d = np.deg2rad(ra), np.deg2rad(dec)
+    cosc = np.sin(d0)*np.sin(d) + np.cos(d0)*np.cos(d)*np.cos(a-a0)
+    x = np.cos(d)*np.sin(a-a0)/cosc
+    y = (np.cos(d0)*np.sin(d) - np.sin(d0)*np.cos(d)*np.cos(a-a0))/cosc
+    pos = np.rad2deg(x + 1j*y)*PLATE_SCALE
+    return pos, tm, pri.astype(np.int32)
+
+
+def syntheticField(ntgt, cbr, seed=42):
+    """Returns `ntgt` targets distributed uniformly over a disk that just
+    covers the patrol area of all cobras."""
+    rng = np.random.default_rng(seed)
+    rmax = np.max(np.abs(cbr["center"]) + cbr["l1"] + cbr["l2"])
+    r = rmax*np.sqrt(rng.random(ntgt))
+    phi = 2*np.pi*rng.random(ntgt)
+    pos = r*np.exp(1j*phi)
+    tm = np.full(ntgt, 900.)
+    pri = rng.integers(1, 6, ntgt).astype(np.int32)
+    return pos, tm, pri
+
+
+def peakMemory():
+    """Returns the peak resident memory of the process in MB."""
+    rss = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    # Linux reports kB, macOS bytes
+    return rss/(1024.**2 if sys.platform == "darwin" else 1024.)
+
+
+def bench(name, ntgt, func, repeat):
+    """Runs `func` `repeat` times and prints the best timing."""
+    best = np.inf
+    for _ in range(repeat):
+        t0 = time.perf_counter()
+        func()
+        best = min(best, time.perf_counter()-t0)
+    print("{:32s} {:10d} {:10.4f} s {:12.4g} tgt/s {:9.1f} MB".format(
+        name, ntgt, best, ntgt/best, peakMemory()))
+
+
+def runField(label, pos, tm, pri, cbr, args):
+    ntgt = len(pos)
+    print("# {}: {} targets".format(label, ntgt))
+    nt, rep = args.nthreads, args.repeat
+
+    # fpraster setup and the fiber/target mappings (calcMappings)
+    bench("visibility", ntgt, lambda: pyETS.getVisArrays(pos, cbr, nt), rep)
+    # a new context every time, since setTargets() with unchanged positions
+    # keeps the mappings
+    bench("context setup", ntgt,
+          lambda: pyETS.ETSContext(cbr, nt).setTargets(pos, tm, pri), rep)
+    ctx = pyETS.ETSContext(cbr, nt)
+    ctx.setTargets(pos, tm, pri)
+
+    # the assigners on prepared mappings; this covers the cleanup() steps
+    # and the priority queues, but not the setup
+    for alg in pyETS.getAssigners():
+        bench("assign " + alg, ntgt, lambda: ctx.getObs(alg), rep)
+    # complete assignments including the setup
+    for alg in pyETS.getAssigners():
+        bench("getObsArrays " + alg, ntgt,
+              lambda: pyETS.getObsArrays(pos, tm, pri, cbr, alg, nt), rep)
+
+    # collision tables for the network flow problem
+    ofs, cobra, elbow = pyETS.getVisArrays(pos, cbr, nt)
+    bench("colliding pairs", ntgt,
+          lambda: pyETS.getCollidingPairs(pos, ofs, 2., nt), rep)
+    bench("elbow collisions", ntgt,
+          lambda: pyETS.getElbowCollisions(pos, ofs, cobra, elbow, 2., nt),
+          rep)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--data", default="data/ets_test_data.dat",
+                        help="target file (empty: skip)")
+    parser.add_argument("--ntgt", type=int, nargs="*",
+                        default=[10000, 100000, 1000000],
+                        help="sizes of the synthetic fields")
+    parser.add_argument("--nthreads", type=int, default=1,
+                        help="number of threads (0: all hardware threads)")
+    parser.add_argument("--repeat", type=int, default=3,
+                        help="number of repetitions of every benchmark")
+    args = parser.parse_args()
+
+    cbr = pyETS.getAllCobrasArray()
+    print("# {:30s} {:>10s} {:>12s} {:>18s} {:>12s}".format(
+        "benchmark", "targets", "time", "throughput", "peak memory"))
+    if args.data:
+        runField(args.data, *readTestData(args.data), cbr, args)
+    for n in args.ntgt:
+        runField("synthetic field", *syntheticField(n, cbr), cbr, args)
+
+
+if __name__ == '__main__':
+    main()
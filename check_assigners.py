@@ -0,0 +1,95 @@
+#!/usr/bin/env python
+"""Consistency checks for the "new_lazy" assigner, run through pyETS.
+
+"new_lazy" uses a different priority queue than "new" but the same strategy,
+so on fields without exactly equal target priorities both must produce
+identical assignments. On lattice fields, where many priorities are equal,
+only the order of ties may differ; there the number of assigned targets must
+agree, and the number of assignments in every priority class within a small
+tolerance (but at least one). The script exits with a nonzero status if a
+check fails; it should be run after changes to the assigners, cleanup() or
+the target tracking of the C++ code.
+
+Examples:
+    python check_assigners.py
+    python check_assigners.py --ntgt 20000 200000 --nthreads 4
+"""
+import argparse
+import sys
+
+import numpy as np
+import pyETS
+
+from bench_ets import syntheticField
+
+
+def latticeField(ntgt, cbr, seed=42):
+    """Returns about `ntgt` targets on a square lattice covering the patrol
+    area of all cobras, with equal observation times and three priority
+    classes, so that many targets have exactly the same priority."""
+    rng = np.random.default_rng(seed)
+    rmax = np.max(np.abs(cbr["center"]) + cbr["l1"] + cbr["l2"])
+    step = rmax*np.sqrt(np.pi/ntgt)
+    x = np.arange(-rmax, rmax, step)
+    pos = (x[:, None] + 1j*x[None, :]).ravel()
+    pos = pos[np.abs(pos) < rmax]
+    tm = np.full(len(pos), 900.)
+    pri = rng.integers(1, 4, len(pos)).astype(np.int32)
+    return pos, tm, pri
+
+
+def classCounts(tid, pri):
+    """Returns a dictionary with the number of assigned targets in every
+    priority class."""
+    p, n = np.unique(pri[tid], return_counts=True)
+    return dict(zip(p.tolist(), n.tolist()))
+
+
+def check(label, ok, detail):
+    print("{:50s} {}  {}".format(label, "ok  " if ok else "FAIL", detail))
+    return ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--ntgt", type=int, nargs="*",
+                        default=[20000, 200000],
+                        help="sizes of the synthetic fields")
+    parser.add_argument("--nthreads", type=int, default=1,
+                        help="number of threads (0: all hardware threads)")
+    parser.add_argument("--tolerance", type=float, default=0.01,
+                        help="relative tolerance of the class counts on "
+                             "lattice fields")
+    args = parser.parse_args()
+
+    cbr = pyETS.getAllCobrasArray()
+    good = True
+    for n in args.ntgt:
+        # continuous random positions: no exact ties
+        pos, tm, pri = syntheticField(n, cbr)
+        ctx = pyETS.ETSContext(cbr, args.nthreads)
+        ctx.setTargets(pos, tm, pri)
+        t0, c0 = ctx.getObs("new")
+        t1, c1 = ctx.getObs("new_lazy")
+        same = np.array_equal(t0, t1) and np.array_equal(c0, c1)
+        good &= check("random field, {} targets".format(len(pos)), same,
+                      "identical assignments" if same else
+                      "{} vs. {} assignments".format(len(t0), len(t1)))
+
+        # lattice: many exact ties
+        pos, tm, pri = latticeField(n, cbr)
+        ctx.setTargets(pos, tm, pri)
+        t0, _ = ctx.getObs("new")
+        t1, _ = ctx.getObs("new_lazy")
+        n0, n1 = classCounts(t0, pri), classCounts(t1, pri)
+        ok = len(t0) == len(t1)
+        for p in set(n0) | set(n1):
+            a, b = n0.get(p, 0), n1.get(p, 0)
+            ok &= abs(a-b) <= max(1, args.tolerance*max(a, b))
+        good &= check("lattice field, {} targets".format(len(pos)), ok,
+                      "class counts {} vs. {}".format(n0, n1))
+    sys.exit(0 if good else 1)
+
+
+if __name__ == '__main__':
+    main()
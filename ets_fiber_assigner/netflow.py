@@ -1,89 +1,154 @@
 from __future__ import print_function
+import time
 import numpy as np
 from collections import defaultdict
 
 
-def _get_colliding_pairs(bench, tpos, vis, dist):
-    tpos = np.array(tpos)
-    ivis = defaultdict(list)
+def _vis_offsets(vis, ntgt):
+    """Returns the offsets of a compressed visibility table (as used by the
+    pyETS functions) for a visibility dictionary as returned by
+    _get_vis_and_elbow()."""
+    cnt = np.zeros(ntgt+1, dtype=np.uint64)
     for tidx, thing in vis.items():
-        for (cidx, _) in thing:
-            ivis[cidx].append(tidx)
-
-    pairs = set()
-    for cidx, i1 in ivis.items():
-        # determine target indices visible by this cobra and its neighbors
-        nb = bench.getCobraNeighbors(cidx)
-        i2 = np.concatenate([ivis[j] for j in nb if j in ivis])
-        i2 = np.concatenate((i1, i2))
-        i2 = np.unique(i2).astype(np.int)
-        d = np.abs(np.subtract.outer(tpos[i1], tpos[i2]))
-        for m in range(d.shape[0]):
-            for n in range(d.shape[1]):
-                if d[m][n] < dist:
-                    if i1[m] < i2[n]:
-                        pairs.add((i1[m], i2[n]))
-    return pairs
-
+        cnt[tidx+1] = len(thing)
+    return np.cumsum(cnt, dtype=np.uint64)
 
-def _get_vis_and_elbow(bench, tpos):
-    from ics.cobraOps.TargetGroup import TargetGroup
-    from ics.cobraOps.TargetSelector import TargetSelector
 
-    class DummyTargetSelector(TargetSelector):
-        def run(self):
-            return
+def _get_colliding_pairs(bench, tpos, vis, dist):
+    import pyETS
+    tpos = np.asarray(tpos, dtype=np.complex128)
+    i1, i2 = pyETS.getCollidingPairs(tpos, _vis_offsets(vis, len(tpos)), dist)
+    return set(zip(i1.tolist(), i2.tolist()))
+
+
+def _cobra_array(bench):
+    """Returns the cobras of a focal plane description as a structured array
+    suitable for the pyETS functions."""
+    import pyETS
+    cobras = bench.cobras
+    res = np.zeros(len(cobras.centers), dtype=pyETS.getAllCobrasArray().dtype)
+    res["center"] = cobras.centers
+    res["l1"] = cobras.L1
+    res["l2"] = cobras.L2
+    # older versions of the focal plane description have no black dots
+    dots = getattr(bench, "blackDots", None)
+    if dots is not None:
+        res["dotpos"] = dots.centers
+        res["rdot"] = dots.radius
+    else:
+        res["dotpos"] = cobras.centers
+        res["rdot"] = 0.
+    return res
 
-        def selectTargets(self):
-            return
 
-    tgroup = TargetGroup(np.array(tpos))
-    tselect = DummyTargetSelector(bench, tgroup)
-    tselect.calculateAccessibleTargets()
-    tmp = tselect.accessibleTargetIndices
-    elb = tselect.accessibleTargetElbows
+def _get_vis_and_elbow(bench, tpos):
+    import pyETS
+    offsets, cidx, elbow = pyETS.getVisArrays(
+        np.asarray(tpos, dtype=np.complex128), _cobra_array(bench))
     res = defaultdict(list)
-
-    for cbr in range(tmp.shape[0]):
-        for i, tidx in enumerate(tmp[cbr, :]):
-            if tidx >= 0:
-                res[tidx].append((cbr, elb[cbr, i]))
+    for tidx in np.nonzero(offsets[1:] > offsets[:-1])[0].tolist():
+        for k in range(offsets[tidx], offsets[tidx+1]):
+            res[tidx].append((int(cidx[k]), elbow[k]))
     return res
 
 
 def _get_elbow_collisions(bench, tpos, vis, dist):
-    tpos = np.array(tpos)
-    ivis = defaultdict(list)
-    epos = defaultdict(list)
+    import pyETS
+    tpos = np.asarray(tpos, dtype=np.complex128)
+    # convert the visibility dictionary to a compressed table
+    offsets = _vis_offsets(vis, len(tpos))
+    nedge = int(offsets[-1])
+    cidx = np.empty(nedge, dtype=np.uint64)
+    elbow = np.empty(nedge, dtype=np.complex128)
     for tidx, cidx_elbow in vis.items():
-        for (cidx, elbowpos) in cidx_elbow:
-            ivis[cidx].append(tidx)
-            epos[cidx].append((tidx, elbowpos))
+        for i, (c, elbowpos) in enumerate(cidx_elbow):
+            cidx[offsets[tidx]+i] = c
+            elbow[offsets[tidx]+i] = elbowpos
+    ofs, blocked = pyETS.getElbowCollisions(tpos, offsets, cidx, elbow, dist)
 
     res = defaultdict(list)
-    for cidx, thing in epos.items():
-        # determine target indices visible by neighbors of this cobra
-        nb = bench.getCobraNeighbors(cidx)
-        tmp = [ivis[j] for j in nb if j in ivis]
-        if tmp != []:
-            i2 = np.concatenate([ivis[j] for j in nb if j in ivis])
-            i2 = np.unique(i2).astype(np.int)
-            # for each target visible by this cobra and the corresponding elbow
-            # position, find all targets which are too close to the "upper arm"
-            # of the cobra
-            for tidx, elbowpos in thing:
-                ebp = np.full(len(i2), elbowpos)
-                tp = np.full(len(i2), tpos[tidx])
-                ti2 = tpos[i2]
-                d = bench.distancesToLineSegments(ti2, tp, ebp)
-                res[(cidx, tidx)] += list(i2[d < dist])
+    for tidx, cidx_elbow in vis.items():
+        for i, (c, _) in enumerate(cidx_elbow):
+            k = offsets[tidx]+i
+            if ofs[k+1] > ofs[k]:
+                res[(c, tidx)] += blocked[ofs[k]:ofs[k+1]].tolist()
     return res
 
 
+def _concat(arrays):
+    if len(arrays) == 0:
+        return np.zeros(0, dtype=np.uint64)
+    return np.concatenate(arrays).astype(np.uint64)
+
+
+def independentTargetSets(bench, tpos, collision_distance=0.,
+                          elbow_collisions=True):
+    """Splits the targets of a multi-visit observation into sets that do not
+    interact: no cobra can observe targets of different sets in the same
+    visit, and no collision constraint connects them.
+
+    Parameters
+    ==========
+    bench : ics.cobraOps.Bench.Bench
+        description of the focal plane
+    tpos : list of list of complex
+        focal plane positions for all targets (inner list) and all visits
+        (outer list)
+    collision_distance : float
+        collision distance between cobra tips, as passed to buildProblem()
+    elbow_collisions : bool
+        as passed to buildProblem()
+
+    Returns
+    =======
+    list of numpy.ndarray of int
+        the target indices of every set, in ascending order. Targets that
+        cannot be observed in any visit are not contained in any set.
+
+    Notes
+    =====
+    The problems built by buildProblem() for the individual sets can be
+    solved separately (e.g. in parallel processes), as long as no constraint
+    acts on whole target classes, i.e. there are no calibration targets with
+    a "numRequired" demand and no "nobs_max" limits.
+    """
+    import pyETS
+    cbr = _cobra_array(bench)
+    ntgt = len(tpos[0])
+    etgt, egroup, pi, pj = [], [], [], []
+    for ivis, tp in enumerate(tpos):
+        tp = np.asarray(tp, dtype=np.complex128)
+        offsets, cidx, elbow = pyETS.getVisArrays(tp, cbr)
+        vtgt = np.repeat(np.arange(ntgt, dtype=np.uint64),
+                         np.diff(offsets).astype(np.int64))
+        etgt.append(vtgt)
+        egroup.append(cidx + np.uint64(ivis*len(cbr)))
+        if collision_distance > 0.:
+            if elbow_collisions:
+                ofs, blocked = pyETS.getElbowCollisions(
+                    tp, offsets, cidx, elbow, collision_distance)
+                pi.append(np.repeat(vtgt, np.diff(ofs).astype(np.int64)))
+                pj.append(blocked)
+            else:
+                i1, i2 = pyETS.getCollidingPairs(tp, offsets,
+                                                 collision_distance)
+                pi.append(i1)
+                pj.append(i2)
+    label, ncomp = pyETS.getTargetComponents(
+        ntgt, _concat(etgt), _concat(egroup), _concat(pi), _concat(pj))
+    if ncomp == 0:
+        return []
+    idx = np.nonzero(label >= 0)[0]
+    idx = idx[np.argsort(label[idx], kind="stable")]
+    bounds = np.cumsum(np.bincount(label[label >= 0], minlength=ncomp))
+    return np.split(idx, bounds[:-1])
+
+
 class LPProblem(object):
     def __init__(self):
         self._vardict={}
         self._constraintdict={}
+        self.stats = {}  # timings (in seconds) of buildProblem() and solve()
 
     def varByName(self, name):
         return self._vardict[name]
@@ -127,9 +192,15 @@ class GurobiProblem(LPProblem):
     def value(var):
         return var.X
 
+    @staticmethod
+    def setStart(var, value):
+        var.Start = value
+
     def solve(self):
+        t0 = time.perf_counter()
         self._prob.setObjective(self.cost)
         self._prob.optimize()
+        self.stats["solve_time"] = time.perf_counter()-t0
 
     def update(self):
         self._prob.update()
@@ -157,6 +228,7 @@ class PulpProblem(LPProblem):
         self.cost = pulp.LpVariable("cost", 0)
         self.sum = pulp.lpSum
         self._constr = []
+        self._warmStart = False
 
     def addVar(self, name, lo, hi):
         import pulp
@@ -176,13 +248,22 @@ class PulpProblem(LPProblem):
         import pulp
         return pulp.value(var)
 
+    def setStart(self, var, value):
+        var.setInitialValue(value)
+        self._warmStart = True
+
     def solve(self):
         import pulp
         self._prob += self.cost
         for i in self._constr:
             self._prob += i
+        options = {}
+        if self._warmStart:
+            options["warmStart"] = True
+        t0 = time.perf_counter()
         self._prob.solve(pulp.COIN_CMD(msg=1, keepFiles=0, maxSeconds=100,
-                                       threads=1, dual=10.))
+                                       threads=1, dual=10., **options))
+        self.stats["solve_time"] = time.perf_counter()-t0
 
     def update(self):
         pass
@@ -202,14 +283,302 @@ class PulpProblem(LPProblem):
             var.upBound = upper
 
 
+class MatrixProblem(object):
+    """ILP problem whose variables and constraints are added in bulk as NumPy
+    arrays. It is handed to Gurobi via its matrix interface, or written to an
+    MPS file for PuLP, so that no Python object is created per variable.
+
+    Variables are identified by their integer index; they are named lazily
+    (see varNames()) for compatibility with the other problem classes."""
+    def __init__(self, name="problem", gurobi=True, extraOptions=None):
+        self._name = name
+        self._gurobi = gurobi
+        self._extraOptions = extraOptions
+        self._nvar = 0
+        self._nconstr = 0
+        self._lo, self._hi, self._cost = [], [], []
+        self._blocks = []  # (stem, name fields) for every addVars() call
+        self._rows, self._cols, self._coefs = [], [], []
+        self._sense, self._rhs = [], []
+        self._startidx, self._startval = [], []
+        self._names = None
+        self._index = None  # name -> index, built on first lookup
+        self._x = None
+        self.stats = {}  # timings (in seconds) of buildProblem() and solve()
+
+    def addVars(self, stem, fields, lo, hi, cost=0.):
+        """Adds len(fields[0]) integer variables (binary, if their bounds are
+        0 and 1). Variable i is called makeName(stem, fields[0][i], ...);
+        scalar entries of `fields` are used for all variables, as are scalar
+        bounds and costs. An upper bound of None means no limit.
+        Returns the indices of the new variables."""
+        n = len(fields[0])
+        if hi is None:
+            hi = np.inf
+        self._lo.append(np.broadcast_to(np.asarray(lo, np.float64), (n,)))
+        self._hi.append(np.broadcast_to(np.asarray(hi, np.float64), (n,)))
+        self._cost.append(np.broadcast_to(np.asarray(cost, np.float64), (n,)))
+        self._blocks.append((stem, fields))
+        self._names = None
+        self._index = None
+        res = np.arange(self._nvar, self._nvar+n)
+        self._nvar += n
+        return res
+
+    def addConstraints(self, nrows, rows, cols, coefs, sense, rhs):
+        """Adds `nrows` constraints of the same `sense` ("<", ">" or "=").
+        Entry k adds coefs[k] times the variable cols[k] to the left-hand side
+        of the new constraint rows[k] (0 <= rows[k] < nrows); `rhs` holds the
+        right-hand sides."""
+        rows = np.asarray(rows, np.int64)
+        self._rows.append(rows+self._nconstr)
+        self._cols.append(np.asarray(cols, np.int64))
+        self._coefs.append(np.broadcast_to(np.asarray(coefs, np.float64),
+                                           rows.shape))
+        self._sense.append(np.full(nrows, sense))
+        self._rhs.append(np.broadcast_to(np.asarray(rhs, np.float64),
+                                         (nrows,)))
+        self._nconstr += nrows
+
+    def setStart(self, var, value):
+        var = np.atleast_1d(np.asarray(var, np.int64))
+        self._startidx.append(var)
+        self._startval.append(np.broadcast_to(np.asarray(value, np.float64),
+                                              var.shape))
+
+    def varNames(self):
+        """Returns the names of all variables, in index order."""
+        if self._names is None:
+            self._names = []
+            for stem, fields in self._blocks:
+                n = len(fields[0])
+                cols = [f if np.ndim(f) > 0 else [f]*n for f in fields]
+                self._names += [makeName(stem, *x) for x in zip(*cols)]
+        return self._names
+
+    @property
+    def _vardict(self):
+        if self._index is None:
+            self._index = {name: i for i, name in enumerate(self.varNames())}
+        return self._index
+
+    def varByName(self, name):
+        return self._vardict[name]
+
+    def value(self, var):
+        return self._x[var]
+
+    @staticmethod
+    def _merge(arrays, dtype):
+        if len(arrays) == 0:
+            return np.zeros(0, dtype=dtype)
+        return np.concatenate(arrays).astype(dtype)
+
+    def _bounds(self):
+        # merge into a single (writable) array
+        if len(self._lo) != 1 or not self._lo[0].flags.writeable:
+            self._lo = [self._merge(self._lo, np.float64)]
+            self._hi = [self._merge(self._hi, np.float64)]
+        return self._lo[0], self._hi[0]
+
+    def varBounds(self, var):
+        lo, hi = self._bounds()
+        return lo[var], hi[var]
+
+    def changeVarBounds(self, var, lower=None, upper=None):
+        lo, hi = self._bounds()
+        if lower is not None:
+            lo[var] = lower
+        if upper is not None:
+            hi[var] = upper
+
+    def _start(self):
+        return (self._merge(self._startidx, np.int64),
+                self._merge(self._startval, np.float64))
+
+    def _matrix(self):
+        lo, hi = self._bounds()
+        return (lo, hi, self._merge(self._cost, np.float64),
+                self._merge(self._rows, np.int64),
+                self._merge(self._cols, np.int64),
+                self._merge(self._coefs, np.float64),
+                self._merge(self._sense, "U1"),
+                self._merge(self._rhs, np.float64))
+
+    def solve(self):
+        t0 = time.perf_counter()
+        if self._gurobi:
+            self._solveGurobi()
+        else:
+            self._solvePulp()
+        self.stats["solve_time"] = time.perf_counter()-t0
+
+    def _solveGurobi(self):
+        import gurobipy as gbp
+        import scipy.sparse
+        lo, hi, cost, rows, cols, coefs, sense, rhs = self._matrix()
+        prob = gbp.Model(self._name)
+        prob.ModelSense = 1  # minimize
+        if self._extraOptions is not None:
+            for key, value in self._extraOptions.items():
+                prob.setParam(key, value)
+        vtype = np.where((lo == 0) & (hi == 1), gbp.GRB.BINARY,
+                         gbp.GRB.INTEGER)
+        x = prob.addMVar(self._nvar, lb=lo, ub=hi, obj=cost, vtype=vtype)
+        A = scipy.sparse.csr_matrix((coefs, (rows, cols)),
+                                    shape=(self._nconstr, self._nvar))
+        prob.addMConstr(A, x, sense, rhs)
+        idx, val = self._start()
+        if len(idx) > 0:
+            start = np.full(self._nvar, gbp.GRB.UNDEFINED)
+            start[idx] = val
+            x.Start = start
+        prob.optimize()
+        self._x = x.X
+
+    def _solvePulp(self):
+        import os
+        import tempfile
+        import pulp
+        fd, fname = tempfile.mkstemp(suffix=".mps")
+        os.close(fd)
+        try:
+            self.dump(fname)
+            variables, prob = pulp.LpProblem.fromMPS(fname,
+                                                     sense=pulp.LpMinimize)
+        finally:
+            os.remove(fname)
+        names = self.varNames()
+        options = {}
+        idx, val = self._start()
+        if len(idx) > 0:
+            for i, v in zip(idx.tolist(), val.tolist()):
+                variables[names[i]].setInitialValue(v)
+            options["warmStart"] = True
+        prob.solve(pulp.COIN_CMD(msg=1, keepFiles=0, maxSeconds=100,
+                                 threads=1, dual=10., **options))
+        self._x = np.array([variables[n].varValue or 0. for n in names])
+
+    def update(self):
+        pass
+
+    def dump(self, filename):
+        """Writes the problem to `filename` in free MPS format."""
+        lo, hi, cost, rows, cols, coefs, sense, rhs = self._matrix()
+        names = self.varNames()
+        order = np.argsort(cols, kind="stable")
+        rows, cols, coefs = rows[order], cols[order], coefs[order]
+        bounds = np.searchsorted(cols, np.arange(self._nvar+1))
+        rtype = {"<": "L", ">": "G", "=": "E"}
+        with open(filename, "w") as f:
+            f.write("NAME {}\nROWS\n N COST\n".format(self._name))
+            for i, s in enumerate(sense.tolist()):
+                f.write(" {} R{}\n".format(rtype[s], i))
+            # all variables of these problems are integers
+            f.write("COLUMNS\n MARKER 'MARKER' 'INTORG'\n")
+            for i, name in enumerate(names):
+                f.write(" {} COST {!r}\n".format(name, float(cost[i])))
+                for k in range(bounds[i], bounds[i+1]):
+                    f.write(" {} R{} {!r}\n".format(name, rows[k],
+                                                    float(coefs[k])))
+            f.write(" MARKER 'MARKER' 'INTEND'\nRHS\n")
+            for i in np.nonzero(rhs)[0].tolist():
+                f.write(" RHS R{} {!r}\n".format(i, float(rhs[i])))
+            f.write("BOUNDS\n")
+            for name, l, h in zip(names, lo.tolist(), hi.tolist()):
+                if l == h:
+                    f.write(" FX BND {} {!r}\n".format(name, l))
+                    continue
+                if l != 0:
+                    f.write(" LO BND {} {!r}\n".format(name, l))
+                if np.isfinite(h):
+                    f.write(" UP BND {} {!r}\n".format(name, h))
+                else:
+                    f.write(" PL BND {}\n".format(name))
+            f.write("ENDATA\n")
+
+
 def makeName(*stuff):
     return "_".join([str(x) for x in stuff])
 
 
+def _greedy_assignments(bench, targets, tpos, classdict, tvisit, nremaining,
+                        assigner, nthreads=1):
+    """Plans all visits with pyETS.getMultiVisitObs() and returns a list
+    containing a set of (target index, cobra index) pairs for every visit.
+    Science targets are only offered as long as they still need
+    observations (`nremaining` holds the number of required visits for every
+    target). The algorithms prefer targets with low priority values, so the
+    target classes are ranked by their cost of not being observed."""
+    import pyETS
+    costs = sorted(set(c["nonObservationCost"] for c in classdict.values()),
+                   reverse=True)
+    rank = {key: costs.index(c["nonObservationCost"])
+            for key, c in classdict.items()}
+    classes = sorted(classdict.keys())
+    clsidx = {c: i for i, c in enumerate(classes)}
+    calib = [bool(classdict[c]["calib"]) for c in classes]
+    minobs = [int(classdict[c]["numRequired"]) if classdict[c]["calib"] else 0
+              for c in classes]
+    cls = np.array([clsidx[t.targetclass] for t in targets], dtype=np.int64)
+    pri = np.array([rank[t.targetclass] for t in targets], dtype=np.int32)
+    tobs = tvisit*np.array(nremaining, dtype=np.float64)
+    pos = np.array([np.asarray(p, dtype=np.complex128) for p in tpos])
+    visits, _ = pyETS.getMultiVisitObs(pos.reshape(len(tpos), len(targets)),
+                                       tobs, pri, cls, calib, minobs,
+                                       _cobra_array(bench), assigner, tvisit,
+                                       nthreads)
+    return [set(zip(tid.tolist(), cid.tolist())) for tid, cid in visits]
+
+
+def greedyAssignments(bench, targets, tpos, classdict, tvisit,
+                      assigner="new", alreadyObserved=None, nthreads=1):
+    """Plan all visits with a fast greedy algorithm instead of the ILP
+
+    This is meant for quick-look planning and as a fallback if the solver
+    does not finish in time. It typically needs about a second, but the
+    assignments are not optimal.
+
+    Parameters
+    ==========
+    bench, targets, tpos, classdict, tvisit, alreadyObserved :
+        as for buildProblem()
+    assigner : string
+        name of the pyETS algorithm (see pyETS.getAssigners()) for the fibers
+        left in every visit after the "numRequired" calibration targets of
+        every calibration class have been assigned
+    nthreads : int
+        number of threads (0: use all available hardware threads)
+
+    Returns
+    =======
+    list of set of (int, int)
+        the (target index, cobra index) pairs observed in every visit
+
+    Notes
+    =====
+    The visits are planned one after the other; science targets are no
+    longer offered once they have received all visits they need. Target
+    classes are prioritized by their "nonObservationCost". Collisions are
+    avoided with a distance of 2mm, and "nobs_max" limits are ignored.
+    """
+    nremaining = []
+    for t in targets:
+        if isinstance(t, ScienceTarget):
+            n = int(t.obs_time/tvisit)
+            if alreadyObserved is not None and t.ID in alreadyObserved:
+                n -= alreadyObserved[t.ID]
+            nremaining.append(max(0, n))
+        else:
+            nremaining.append(0)
+    return _greedy_assignments(bench, targets, tpos, classdict, tvisit,
+                               nremaining, assigner, nthreads)
+
+
 def buildProblem(bench, targets, tpos, classdict, tvisit, vis_cost=None,
                  cobraMoveCost=None, collision_distance=0.,
                  elbow_collisions=True, gurobi=True, gurobiOptions=None,
-                 alreadyObserved=None):
+                 alreadyObserved=None, warmStart=None, vectorized=False):
     """Build the ILP problem for a given observation task
 
     Parameters
@@ -245,7 +614,25 @@ def buildProblem(bench, targets, tpos, classdict, tvisit, vis_cost=None,
     alreadyObserved : None or dict{string: int}
         if not None, this is a dictionary containing IDs of science targets
         and the number of visits they have already been observed
+    warmStart : None or string
+        if not None, the name of a pyETS assignment algorithm (see
+        pyETS.getAssigners(), e.g. "draining" or "new"). The assignment this
+        algorithm finds for every visit is passed to the solver as start
+        values of the target visit and cobra flows (see greedyAssignments()).
+        The start solution always uses a collision distance of 2mm and
+        ignores "nobs_max", so the solver may have to repair it.
+    vectorized : bool
+        if True, the problem is built from NumPy arrays and returned as a
+        MatrixProblem, which is passed to the solver in bulk. This is much
+        faster for large problems and describes the same network.
+
+    Notes
+    =====
+    The time needed to build the problem (including the start solution) is
+    stored in the `stats` dictionary of the returned problem as
+    "build_time"; solve() adds "solve_time".
     """
+    t0 = time.perf_counter()
     Cv_i = defaultdict(list)  # Cobra visit inflows
     Tv_o = defaultdict(list)  # Target visit outflows
     Tv_i = defaultdict(list)  # Target visit inflows
@@ -254,11 +641,6 @@ def buildProblem(bench, targets, tpos, classdict, tvisit, vis_cost=None,
     CTCv_o = defaultdict(list)  # Calibration Target class visit outflows
     STC_o = defaultdict(list)  # Science Target outflows
 
-    if gurobi:
-        prob = GurobiProblem(extraOptions=gurobiOptions)
-    else:
-        prob = PulpProblem()
-
     nreqvisit = []
     ndone = []
     for t in targets:
@@ -278,6 +660,25 @@ def buildProblem(bench, targets, tpos, classdict, tvisit, vis_cost=None,
     if vis_cost is None:
         vis_cost = [0.] * nvisits
 
+    if warmStart is not None:
+        print("Computing start solution")
+        nremaining = [max(0, n-d) for n, d in zip(nreqvisit, ndone)]
+        start = _greedy_assignments(bench, targets, tpos, classdict, tvisit,
+                                    nremaining, warmStart)
+
+    if vectorized:
+        prob = _buildMatrixProblem(
+            bench, targets, tpos, classdict, vis_cost, cobraMoveCost,
+            collision_distance, elbow_collisions, gurobi, gurobiOptions,
+            nreqvisit, ndone, start if warmStart is not None else None)
+        prob.stats["build_time"] = time.perf_counter()-t0
+        return prob
+
+    if gurobi:
+        prob = GurobiProblem(extraOptions=gurobiOptions)
+    else:
+        prob = PulpProblem()
+
     # define LP variables
 
     print("Creating network topology")
@@ -294,6 +695,9 @@ def buildProblem(bench, targets, tpos, classdict, tvisit, vis_cost=None,
         print("  exposure {}".format(ivis+1))
         print("Calculating visibilities")
         vis = _get_vis_and_elbow(bench, tpos[ivis])
+        if warmStart is not None:
+            assigned = start[ivis]
+            tassigned = set(t for t, _ in assigned)
         for tidx, thing in vis.items():
             tgt = targets[tidx]
             TC = tgt.targetclass
@@ -301,6 +705,8 @@ def buildProblem(bench, targets, tpos, classdict, tvisit, vis_cost=None,
             if isinstance(tgt, ScienceTarget):
                 # Target node to target visit node
                 f = prob.addVar(makeName("T_Tv", tgt.ID, ivis), 0, 1)
+                if warmStart is not None:
+                    prob.setStart(f, int(tidx in tassigned))
                 T_o[tidx].append(f)
                 Tv_i[(tidx, ivis)].append(f)
                 if len(T_o[tidx]) == 1:  # freshly created
@@ -321,11 +727,15 @@ def buildProblem(bench, targets, tpos, classdict, tvisit, vis_cost=None,
             elif isinstance(tgt, CalibTarget):
                 # Calibration Target class node to target visit node
                 f = prob.addVar(makeName("CTCv_Tv", TC, tgt.ID, ivis), 0, 1)
+                if warmStart is not None:
+                    prob.setStart(f, int(tidx in tassigned))
                 Tv_i[(tidx, ivis)].append(f)
                 CTCv_o[(TC, ivis)].append(f)
             for (cidx, _) in thing:
                 # target visit node to cobra visit node
                 f = prob.addVar(makeName("Tv_Cv", tidx, cidx, ivis), 0, 1)
+                if warmStart is not None:
+                    prob.setStart(f, int((tidx, cidx) in assigned))
                 Cv_i[(cidx, ivis)].append(f)
                 Tv_o[(tidx, ivis)].append((f, cidx))
                 tcost = vis_cost[ivis]
@@ -404,6 +814,195 @@ def buildProblem(bench, targets, tpos, classdict, tvisit, vis_cost=None,
         prob.add_constraint(makeName("ST", key[0], key[1]),
             prob.sum([v for v in val]) == n_obs)
 
+    prob.stats["build_time"] = time.perf_counter()-t0
+    return prob
+
+
+def _ranges(starts, counts):
+    """Returns the concatenation of the index ranges
+    [starts[i]; starts[i]+counts[i][."""
+    starts = np.asarray(starts, np.int64)
+    counts = np.asarray(counts, np.int64)
+    ends = np.cumsum(counts)
+    total = int(ends[-1]) if len(ends) > 0 else 0
+    return np.repeat(starts-(ends-counts), counts) + np.arange(total)
+
+
+def _move_cost(cobraMoveCost, dist):
+    """Evaluates cobraMoveCost for an array of distances; functions that do
+    not accept NumPy arrays are called for every distance."""
+    try:
+        res = np.asarray(cobraMoveCost(dist), dtype=np.float64)
+        if res.shape == dist.shape:
+            return res
+    except (TypeError, ValueError):
+        pass
+    return np.array([cobraMoveCost(d) for d in dist], dtype=np.float64)
+
+
+def _buildMatrixProblem(bench, targets, tpos, classdict, vis_cost,
+                        cobraMoveCost, collision_distance, elbow_collisions,
+                        gurobi, gurobiOptions, nreqvisit, ndone, start):
+    """Array-based variant of buildProblem(); the parameters have the same
+    meaning, `start` holds the result of _greedy_assignments() or None."""
+    import pyETS
+    prob = MatrixProblem(gurobi=gurobi, extraOptions=gurobiOptions)
+    cbr = _cobra_array(bench)
+    ncobra = len(cbr)
+    ntgt = len(targets)
+    nvisits = len(tpos)
+    ids = np.array([t.ID for t in targets], dtype=object)
+    tclass = np.array([t.targetclass for t in targets], dtype=object)
+    is_sci = np.array([isinstance(t, ScienceTarget) for t in targets],
+                      dtype=bool)
+    is_cal = np.array([isinstance(t, CalibTarget) for t in targets],
+                      dtype=bool)
+    ndone = np.asarray(ndone, dtype=np.int64)
+    nvis = np.maximum(np.asarray(nreqvisit, dtype=np.int64)-ndone, 0)
+    classes = list(classdict.keys())
+    cpos = {c: i for i, c in enumerate(classes)}
+    tci = np.array([cpos[c] for c in tclass], dtype=np.int64)
+    ncost = np.array([classdict[c]["nonObservationCost"] for c in classes])
+
+    print("Creating network topology")
+    # calibration target class sinks, and the inflows of every calibration
+    # target class and visit
+    calib = [i for i, c in enumerate(classes) if classdict[c]["calib"]]
+    calrow = np.full(len(classes), -1, dtype=np.int64)
+    calrow[calib] = np.arange(len(calib))
+    sink = prob.addVars("CTCv_sink",
+                        [np.repeat(np.array(classes, dtype=object)[calib],
+                                   nvisits),
+                         np.tile(np.arange(nvisits), len(calib))],
+                        0, None, np.repeat(ncost[calib], nvisits))
+    CTCv_rows = [np.arange(len(sink))]
+    CTCv_cols = [sink]
+    sci_tgt, sci_var = [], []  # science target visit nodes of all visits
+    for ivis in range(nvisits):
+        print("  exposure {}".format(ivis+1))
+        print("Calculating visibilities")
+        tp = np.asarray(tpos[ivis], dtype=np.complex128)
+        offsets, cidx, elbow = pyETS.getVisArrays(tp, cbr)
+        ofs = offsets.astype(np.int64)
+        cidx = cidx.astype(np.int64)
+        cnt = np.diff(ofs)
+        etgt = np.repeat(np.arange(ntgt), cnt)
+        vsci = np.nonzero((cnt > 0) & is_sci)[0]
+        vcal = np.nonzero((cnt > 0) & is_cal)[0]
+
+        # target visit node to cobra visit node
+        tcost = np.full(len(etgt), float(vis_cost[ivis]))
+        if cobraMoveCost is not None:
+            tcost += _move_cost(cobraMoveCost,
+                                np.abs(bench.cobras.centers[cidx]-tp[etgt]))
+        edge = prob.addVars("Tv_Cv", [etgt, cidx, ivis], 0, 1, tcost)
+        # target node to target visit node (science targets) and
+        # calibration target class node to target visit node
+        ttv = prob.addVars("T_Tv", [ids[vsci], ivis], 0, 1)
+        ctv = prob.addVars("CTCv_Tv", [tclass[vcal], ids[vcal], ivis], 0, 1)
+        sci_tgt.append(vsci)
+        sci_var.append(ttv)
+        ok = calrow[tci[vcal]] >= 0
+        CTCv_rows.append(calrow[tci[vcal[ok]]]*nvisits+ivis)
+        CTCv_cols.append(ctv[ok])
+        if start is not None:
+            key = np.array([t*ncobra+c for t, c in start[ivis]],
+                           dtype=np.int64)
+            prob.setStart(edge, np.isin(etgt*ncobra+cidx, key))
+            assigned = np.zeros(ntgt, dtype=bool)
+            assigned[[t for t, _ in start[ivis]]] = True
+            prob.setStart(ttv, assigned[vsci])
+            prob.setStart(ctv, assigned[vcal])
+
+        print("adding constraints")
+        # inflow and outflow at every Tv node must be balanced
+        inflow = np.full(ntgt, -1, dtype=np.int64)
+        inflow[vsci] = ttv
+        inflow[vcal] = ctv
+        tv = np.nonzero(inflow >= 0)[0]
+        tvrow = np.full(ntgt, -1, dtype=np.int64)
+        tvrow[tv] = np.arange(len(tv))
+        out = tvrow[etgt] >= 0
+        prob.addConstraints(
+            len(tv), np.concatenate([tvrow[tv], tvrow[etgt[out]]]),
+            np.concatenate([inflow[tv], edge[out]]),
+            np.concatenate([np.ones(len(tv)), -np.ones(out.sum())]),
+            "=", 0.)
+
+        # every Cobra can observe at most one target per visit
+        cobras, crow = np.unique(cidx, return_inverse=True)
+        prob.addConstraints(len(cobras), crow, edge, 1., "<", 1.)
+
+        # avoid endpoint collisions
+        if collision_distance > 0.:
+            print("adding collision constraints")
+            if not elbow_collisions:
+                i1, i2 = pyETS.getCollidingPairs(tp, offsets,
+                                                 collision_distance)
+                i1, i2 = i1.astype(np.int64), i2.astype(np.int64)
+                rows = np.arange(len(i1))
+                e1 = _ranges(ofs[i1], cnt[i1])
+                e2 = _ranges(ofs[i2], cnt[i2])
+                prob.addConstraints(
+                    len(i1), np.concatenate([np.repeat(rows, cnt[i1]),
+                                             np.repeat(rows, cnt[i2])]),
+                    edge[np.concatenate([e1, e2])], 1., "<", 1.)
+            else:
+                bofs, blocked = pyETS.getElbowCollisions(
+                    tp, offsets, cidx.astype(np.uint64), elbow,
+                    collision_distance)
+                blocked = blocked.astype(np.int64)
+                # the combination itself, and all combinations of the
+                # blocked targets with other cobras
+                k = np.repeat(np.arange(len(etgt)),
+                              np.diff(bofs.astype(np.int64)))
+                rows = np.arange(len(blocked))
+                e2 = _ranges(ofs[blocked], cnt[blocked])
+                r2 = np.repeat(rows, cnt[blocked])
+                other = cidx[e2] != cidx[k[r2]]
+                prob.addConstraints(
+                    len(blocked), np.concatenate([rows, r2[other]]),
+                    edge[np.concatenate([k, e2[other]])], 1., "<", 1.)
+
+    # every calibration target class must be observed a minimum number of times
+    # every visit
+    prob.addConstraints(
+        len(sink), np.concatenate(CTCv_rows), np.concatenate(CTCv_cols), 1.,
+        ">", np.repeat([classdict[classes[i]]["numRequired"] for i in calib],
+                       nvisits))
+
+    # science target nodes, their inflow from the science target class nodes
+    # and their outflow to the sink
+    sci_tgt = np.concatenate(sci_tgt) if nvisits else np.zeros(0, np.int64)
+    sci_var = np.concatenate(sci_var) if nvisits else np.zeros(0, np.int64)
+    sci = np.unique(sci_tgt)
+    pcost = np.array([classdict[c].get("partialObservationCost", 0.)
+                      for c in classes])
+    stct = prob.addVars("STC_T", [tclass[sci], ids[sci]],
+                        (ndone[sci] > 0).astype(np.float64), 1)
+    stsink = prob.addVars("ST_sink", [ids[sci]], 0, None, pcost[tci[sci]])
+    # inflow and outflow at every T node must be balanced
+    trow = np.searchsorted(sci, sci_tgt)
+    rows = np.arange(len(sci))
+    prob.addConstraints(
+        len(sci), np.concatenate([rows, rows, trow]),
+        np.concatenate([stct, stsink, sci_var]),
+        np.concatenate([nvis[sci], -np.ones(len(sci)+len(trow))]),
+        "=", 0.)
+
+    # Science targets must be either observed or go to the sink
+    sclass, srow = np.unique(tci[sci], return_inverse=True)
+    stcsink = prob.addVars("STC_sink",
+                           [np.array(classes, dtype=object)[sclass]],
+                           0, None, ncost[sclass])
+    nobs = np.bincount(srow, minlength=len(sclass))
+    for i, c in enumerate(sclass.tolist()):
+        if "nobs_max" in classdict[classes[c]]:
+            nobs[i] = classdict[classes[c]]["nobs_max"]
+    prob.addConstraints(
+        len(sclass), np.concatenate([srow, np.arange(len(sclass))]),
+        np.concatenate([stct, stcsink]), 1., "=", nobs)
+
     return prob
 
 
@@ -443,14 +1042,66 @@ class Telescope(object):
             the focal plane positions encoded as complex numbers
         """
         from pfs.utils.coordinates.CoordTransp import CoordinateTransform as ctrans
-        tmp = np.zeros((2,len(tgt)), dtype=np.float64)
-        for i, t in enumerate(tgt):
-            tmp[0, i], tmp[1, i] = t.ra, t.dec
+        tmp = np.array([[t.ra for t in tgt], [t.dec for t in tgt]],
+                       dtype=np.float64).reshape((2, len(tgt)))
         tmp = ctrans(xyin=tmp,
             za=0., mode="sky_pfi", inr=0., pa=self._posang,
             cent=np.array([self._ra, self._dec]), time=self._time)
         return tmp[0, :] + 1j*tmp[1, :]
 
+    def get_fp_positions_in_field(self, tgt, radius=0.75, index=None):
+        """Returns focal plane positions for the targets close to the
+        telescope pointing; all other targets are not projected at all.
+
+        Parameters
+        ==========
+        tgt : list of Target objects
+            the candidate targets
+        radius : float
+            field radius in degrees; the default is slightly larger than the
+            radius of the PFI patrol region
+        index : pyETS.SkyIndex or None
+            index of the positions of `tgt` (see skyIndex()). Building it once
+            and passing it for every pointing saves the setup time.
+
+        Returns
+        =======
+        numpy.ndarray of int, numpy.ndarray of complex
+            the indices of the targets within `radius` (in ascending order),
+            and their focal plane positions
+        """
+        if index is None:
+            index = skyIndex(tgt)
+        idx = index.query(self._ra, self._dec, radius)
+        if len(idx) == 0:
+            return idx, np.zeros(0, dtype=np.complex128)
+        return idx, self.get_fp_positions([tgt[i] for i in idx.tolist()])
+
+
+def skyIndex(tgt, bandwidth=0.5):
+    """Returns a pyETS.SkyIndex of the positions of the targets `tgt`, as
+    used by Telescope.get_fp_positions_in_field(). `bandwidth` is the height
+    of the declination bands of the index in degrees."""
+    import pyETS
+    ra = np.array([t.ra for t in tgt], dtype=np.float64)
+    dec = np.array([t.dec for t in tgt], dtype=np.float64)
+    return pyETS.SkyIndex(ra, dec, bandwidth)
+
+
+def pfiProjection(obs_time):
+    """Returns a projection for pyETS.planSurvey() that uses the PFS
+    coordinate transformation (like Telescope.get_fp_positions()) for
+    observations at `obs_time`."""
+    from pfs.utils.coordinates.CoordTransp import CoordinateTransform as ctrans
+
+    def project(pointing, ra, dec):
+        ra0, dec0, posang, _ = pointing
+        tmp = ctrans(xyin=np.stack((ra, dec)),
+            za=0., mode="sky_pfi", inr=0., pa=posang,
+            cent=np.array([ra0, dec0]), time=obs_time)
+        return tmp[0, :] + 1j*tmp[1, :]
+    return project
+
 
 class Target(object):
     """Base class for all target types observable with PFS. All targets are
@@ -590,3 +1241,75 @@ def readCalibrationFromFile(file, targetclass):
                 id_, ra, dec = (str(tt[0]), float(tt[1]), float(tt[2]))
                 res.append(CalibTarget(id_, ra, dec, targetclass))
     return res
+
+
+def _read_text_catalog(file):
+    """Returns the whitespace-separated columns of all target lines of a text
+    catalog in the format read by readScientificFromFile()."""
+    with open(file) as f:
+        ll = f.readlines()
+    return [l.split() for l in ll[1:] if not l.startswith("#")]
+
+
+def convertToCatalog(outfile, science=(), calibration=()):
+    """Converts text target files into a single binary catalog, which can be
+    read much faster with readCatalog().
+
+    Parameters
+    ==========
+    outfile : string
+        the name of the binary catalog file
+    science : list of (string, string)
+        pairs of file name and prefix, as passed to readScientificFromFile()
+    calibration : list of (string, string)
+        pairs of file name and target class, as passed to
+        readCalibrationFromFile()
+    """
+    import pyETS
+    ids, ra, dec, tobs, pri, cls = [], [], [], [], [], []
+    classes, calib = [], []
+    for files, iscalib in ((science, False), (calibration, True)):
+        for file, name in files:
+            classes.append(name)
+            calib.append(iscalib)
+            for tt in _read_text_catalog(file):
+                ids.append(str(tt[0]))
+                ra.append(float(tt[1]))
+                dec.append(float(tt[2]))
+                tobs.append(0. if iscalib else float(tt[3]))
+                pri.append(0 if iscalib else int(tt[4]))
+                cls.append(len(classes)-1)
+    pyETS.writeCatalog(outfile, ids, ra, dec, tobs, pri, cls, classes, calib)
+
+
+def readCatalog(file):
+    """Read all targets from a binary catalog written by convertToCatalog()
+
+    Parameters
+    ==========
+    file : string
+        the name of the catalog file
+
+    Returns
+    =======
+    list of Target : the created ScienceTarget and CalibTarget objects, in
+        the order of the input files passed to convertToCatalog()
+
+    Notes
+    =====
+    pyETS.TargetCatalog(file) gives direct access to the columns of the
+    catalog as NumPy arrays, without creating any Target objects.
+    """
+    import pyETS
+    cat = pyETS.TargetCatalog(file)
+    classes, calib = cat.classes, cat.calib
+    res = []
+    for id_, ra, dec, tm, pri, c in zip(
+            cat.ids.tolist(), cat.ra.tolist(), cat.dec.tolist(),
+            cat.time.tolist(), cat.pri.tolist(), cat.cls.tolist()):
+        id_ = id_.decode()
+        if calib[c]:
+            res.append(CalibTarget(id_, ra, dec, classes[c]))
+        else:
+            res.append(ScienceTarget(id_, ra, dec, tm, pri, classes[c]))
+    return res
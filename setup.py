@@ -1,5 +1,6 @@
 from setuptools import setup, Extension, find_packages
 from setuptools.command.build_ext import build_ext
+import os
 import sys
 import setuptools
 
@@ -23,7 +24,8 @@ extsrc = ['src/external/string_utils.cc', 'src/external/error_handling.cc']
 ext_modules = [
     Extension(
         'pyETS',
-        ['src/pyETS.cc','src/ets.cc'] + extsrc,
+        ['src/pyETS.cc','src/ets.cc','src/catalog.cc',
+         'src/skyindex.cc','src/planner.cc'] + extsrc,
         include_dirs=['src','src/external',
             # Path to pybind11 headers
             get_pybind_include(),
@@ -75,15 +77,28 @@ class BuildExt(build_ext):
     def build_extensions(self):
         ct = self.compiler.compiler_type
         opts = self.c_opts.get(ct, [])
+        link_opts = []
         if ct == 'unix':
             opts.append('-DVERSION_INFO="%s"' % self.distribution.get_version())
             opts.append(cpp_flag(self.compiler))
             if has_flag(self.compiler, '-fvisibility=hidden'):
                 opts.append('-fvisibility=hidden')
+            if has_flag(self.compiler, '-pthread'):
+                opts.append('-pthread')
+                link_opts.append('-pthread')
+            if has_flag(self.compiler, '-fopenmp-simd'):
+                opts += ['-fopenmp-simd', '-DETS_OPENMP_SIMD']
         elif ct == 'msvc':
             opts.append('/DVERSION_INFO=\\"%s\\"' % self.distribution.get_version())
+        # compact index mode for very large target lists (see src/ets.cc)
+        if os.environ.get('ETS_COMPACT_INDEX'):
+            opts.append(('/D' if ct == 'msvc' else '-D') + 'ETS_COMPACT_INDEX')
+        # timings and counters for pyETS.Stats (see src/ets.h)
+        if os.environ.get('ETS_STATS'):
+            opts.append(('/D' if ct == 'msvc' else '-D') + 'ETS_STATS')
         for ext in self.extensions:
             ext.extra_compile_args = opts
+            ext.extra_link_args = link_opts
         build_ext.build_extensions(self)
 
 setup(name="ets_fiber_assigner",
@@ -0,0 +1,180 @@
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "catalog.h"
+#include "error_handling.h"
+
+using namespace std;
+
+namespace {
+
+const char catalog_magic[8] = { 'E','T','S','C','A','T','0','1' };
+constexpr size_t header_size = 8+4*sizeof(uint64_t);
+
+inline size_t align8 (size_t ofs)
+  { return (ofs+7)&~size_t(7); }
+
+/*! Offsets of all sections of a catalog file. */
+struct catalog_layout
+  {
+  size_t cls, calib, ids, ra, dec, time, pri, clsidx, end;
+
+  catalog_layout (size_t nrow, size_t idw, size_t ncls, size_t clsw)
+    {
+    cls=header_size;
+    calib=cls+ncls*clsw;
+    ids=align8(calib+ncls);
+    ra=align8(ids+nrow*idw);
+    dec=ra+nrow*sizeof(double);
+    time=dec+nrow*sizeof(double);
+    pri=time+nrow*sizeof(double);
+    clsidx=align8(pri+nrow*sizeof(int32_t));
+    end=clsidx+nrow*sizeof(int32_t);
+    }
+  };
+
+/*! Returns the zero-padded string of at most \a width bytes at \a p. */
+string padded_string (const char *p, size_t width)
+  { return string(p, strnlen(p, width)); }
+
+/*! Writes \a s zero-padded to \a width bytes. */
+void write_padded (ofstream &out, const string &s, size_t width)
+  {
+  out.write(s.data(), s.size());
+  for (size_t i=s.size(); i<width; ++i) out.put(0);
+  }
+
+void write_padding (ofstream &out)
+  {
+  while (size_t(out.tellp())%8!=0) out.put(0);
+  }
+
+/*! Releases the memory returned by map_catalog(). */
+void release_catalog (void *base, size_t len)
+  {
+#ifdef _WIN32
+  (void)len;
+  free(base);
+#else
+  munmap(base, len);
+#endif
+  }
+
+/*! Returns the contents of \a filename, which must be at least \a minlen
+    bytes long, and stores its length in \a len. The file is memory-mapped
+    where mmap() is available (the mapping stays valid after closing the
+    file), and read into memory otherwise. */
+void *map_catalog (const string &filename, size_t minlen, size_t &len)
+  {
+#ifdef _WIN32
+  ifstream in(filename, ios::binary);
+  planck_assert(in, "cannot open catalog file '"+filename+"'");
+  in.seekg(0, ios::end);
+  len=size_t(in.tellg());
+  in.seekg(0);
+  if (len<minlen) planck_fail("'"+filename+"' is not a target catalog");
+  void *base=malloc(len);
+  planck_assert(base!=nullptr, "cannot allocate memory for '"+filename+"'");
+  if (!in.read(reinterpret_cast<char *>(base), len))
+    { free(base); planck_fail("error reading catalog file '"+filename+"'"); }
+  return base;
+#else
+  int fd=open(filename.c_str(), O_RDONLY);
+  planck_assert(fd>=0, "cannot open catalog file '"+filename+"'");
+  struct stat st;
+  if (fstat(fd,&st)!=0)
+    { close(fd); planck_fail("cannot stat catalog file '"+filename+"'"); }
+  len=st.st_size;
+  if (len<minlen)
+    { close(fd); planck_fail("'"+filename+"' is not a target catalog"); }
+  void *base=mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  planck_assert(base!=MAP_FAILED, "cannot map catalog file '"+filename+"'");
+  return base;
+#endif
+  }
+
+} // unnamed namespace
+
+TargetCatalog::TargetCatalog (const string &filename)
+  : base(nullptr), len(0)
+  {
+  base=map_catalog(filename, header_size, len);
+  const char *p=reinterpret_cast<const char *>(base);
+  uint64_t hdr[4];
+  memcpy(hdr, p+8, sizeof(hdr));
+  nrow=hdr[0]; idw=hdr[1]; ncls=hdr[2]; clsw=hdr[3];
+  // make sure that the section sizes cannot overflow for broken headers
+  bool ok = (memcmp(p, catalog_magic, 8)==0) && (nrow<=len/8) && (ncls<=len)
+    && ((idw==0) || (nrow<=len/idw)) && ((clsw==0) || (ncls<=len/clsw));
+  if (ok) ok = (catalog_layout(nrow, idw, ncls, clsw).end<=len);
+  if (!ok)
+    {
+    release_catalog(base, len);
+    planck_fail("'"+filename+"' is not a valid target catalog");
+    }
+  catalog_layout lay(nrow, idw, ncls, clsw);
+  pcls=p+lay.cls;
+  pcalib=reinterpret_cast<const uint8_t *>(p+lay.calib);
+  pids=p+lay.ids;
+  pra=reinterpret_cast<const double *>(p+lay.ra);
+  pdec=reinterpret_cast<const double *>(p+lay.dec);
+  ptime=reinterpret_cast<const double *>(p+lay.time);
+  ppri=reinterpret_cast<const int32_t *>(p+lay.pri);
+  pclsidx=reinterpret_cast<const int32_t *>(p+lay.clsidx);
+  for (size_t i=0; i<nrow; ++i)
+    if ((pclsidx[i]<0)||(size_t(pclsidx[i])>=ncls))
+      {
+      release_catalog(base, len);
+      planck_fail("bad class index in target catalog '"+filename+"'");
+      }
+  }
+
+TargetCatalog::~TargetCatalog()
+  { release_catalog(base, len); }
+
+string TargetCatalog::id (size_t i) const
+  { return padded_string(pids+i*idw, idw); }
+
+string TargetCatalog::className (size_t i) const
+  { return padded_string(pcls+i*clsw, clsw); }
+
+void writeTargetCatalog (const string &filename, const vector<string> &ids,
+  const vector<double> &ra, const vector<double> &dec,
+  const vector<double> &time, const vector<int32_t> &pri,
+  const vector<int32_t> &cls, const vector<string> &classes,
+  const vector<uint8_t> &calib)
+  {
+  size_t nrow=ids.size(), ncls=classes.size();
+  planck_assert((ra.size()==nrow)&&(dec.size()==nrow)&&(time.size()==nrow)
+    &&(pri.size()==nrow)&&(cls.size()==nrow), "column length mismatch");
+  planck_assert(calib.size()==ncls, "class table length mismatch");
+  for (auto c : cls)
+    planck_assert((c>=0)&&(size_t(c)<ncls), "bad class index");
+  uint64_t hdr[4] = { nrow, 1, ncls, 1 };
+  for (const auto &id : ids) hdr[1]=max<uint64_t>(hdr[1], id.size());
+  for (const auto &c : classes) hdr[3]=max<uint64_t>(hdr[3], c.size());
+
+  ofstream out(filename, ios::binary);
+  planck_assert(out, "cannot create catalog file '"+filename+"'");
+  out.write(catalog_magic, 8);
+  out.write(reinterpret_cast<const char *>(hdr), sizeof(hdr));
+  for (const auto &c : classes) write_padded(out, c, hdr[3]);
+  out.write(reinterpret_cast<const char *>(calib.data()), ncls);
+  write_padding(out);
+  for (const auto &id : ids) write_padded(out, id, hdr[1]);
+  write_padding(out);
+  for (const auto *col : { &ra, &dec, &time })
+    out.write(reinterpret_cast<const char *>(col->data()),
+      nrow*sizeof(double));
+  out.write(reinterpret_cast<const char *>(pri.data()), nrow*sizeof(int32_t));
+  write_padding(out);
+  out.write(reinterpret_cast<const char *>(cls.data()), nrow*sizeof(int32_t));
+  planck_assert(out, "error writing catalog file '"+filename+"'");
+  }
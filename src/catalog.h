@@ -0,0 +1,99 @@
+/*
+ *  This file is part of ets_fiber_assigner.
+ *
+ *  ets_fiber_assigner is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ets_fiber_assigner is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ets_fiber_assigner; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ *  ets_fiber_assigner is being developed at the Max-Planck-Institut fuer
+ *  Astrophysik.
+ */
+
+#ifndef ETS_CATALOG_H
+#define ETS_CATALOG_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*! Read-only access to a binary target catalog. The file is memory-mapped,
+    so that opening it costs almost nothing and all columns can be used
+    without copying or parsing. (On Windows, it is read into memory
+    instead.)
+
+    The file (in the byte order of the machine that wrote it) consists of
+    - the magic string "ETSCAT01", followed by the uint64 values nrow,
+      idwidth, nclass and classwidth,
+    - the names of all target classes as zero-padded strings of classwidth
+      bytes, followed by one byte per class, which is 1 for calibration
+      classes and 0 for science target prefixes,
+    - the columns: the target IDs as zero-padded strings of idwidth bytes,
+      RA, Dec (in degrees) and the observation time (in seconds) as double,
+      and the priority and class index as int32.
+    Every section starts at a multiple of 8 bytes. */
+class TargetCatalog
+  {
+  private:
+    void *base;
+    size_t len, nrow, idw, ncls, clsw;
+    const char *pids, *pcls;
+    const double *pra, *pdec, *ptime;
+    const int32_t *ppri, *pclsidx;
+    const uint8_t *pcalib;
+
+  public:
+    /*! Maps the catalog stored in \a filename. Throws if the file is not
+        a valid catalog, e.g. if a class index is out of range. */
+    explicit TargetCatalog (const std::string &filename);
+    TargetCatalog (const TargetCatalog &) = delete;
+    TargetCatalog &operator= (const TargetCatalog &) = delete;
+    ~TargetCatalog();
+
+    /*! Returns the number of targets. */
+    size_t size() const { return nrow; }
+    /*! Returns the number of bytes used for every ID. */
+    size_t idWidth() const { return idw; }
+    /*! Returns a pointer to the IDs, which are stored one after the other,
+        zero-padded to idWidth() bytes. */
+    const char *ids() const { return pids; }
+    /*! Returns the ID of target \a i. */
+    std::string id (size_t i) const;
+    const double *ra() const { return pra; }
+    const double *dec() const { return pdec; }
+    const double *time() const { return ptime; }
+    const int32_t *pri() const { return ppri; }
+    /*! Returns the class index of every target; all of them are smaller
+        than nClasses(). */
+    const int32_t *cls() const { return pclsidx; }
+
+    size_t nClasses() const { return ncls; }
+    /*! Returns the name of class \a i: the target class of calibration
+        targets, or the prefix of science targets. */
+    std::string className (size_t i) const;
+    /*! Returns \a true if class \a i contains calibration targets. */
+    bool isCalib (size_t i) const { return pcalib[i]!=0; }
+  };
+
+/*! Writes a catalog in the format read by TargetCatalog. All columns must
+    have the same length, which is also the length of \a ids; target i
+    belongs to the class classes[cls[i]], and calib[j] marks the calibration
+    classes. */
+void writeTargetCatalog (const std::string &filename,
+  const std::vector<std::string> &ids, const std::vector<double> &ra,
+  const std::vector<double> &dec, const std::vector<double> &time,
+  const std::vector<int32_t> &pri, const std::vector<int32_t> &cls,
+  const std::vector<std::string> &classes, const std::vector<uint8_t> &calib);
+
+#endif
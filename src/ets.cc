@@ -1,4 +1,13 @@
-#include <random>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <limits>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <cstddef>
+#include <chrono>
 #include "ets.h"
 #include "ets_helpers.h"
 #include "error_handling.h"
@@ -7,6 +16,122 @@ using namespace std;
 
 namespace {
 
+/* Instrumentation: with -DETS_STATS, the code counts events and measures the
+   time spent in its main phases. The numbers are gathered per thread and
+   added to the ETSStats object bound to the thread (see ETSStats and
+   parallel_ranges()). Without ETS_STATS, all of this compiles to nothing. */
+enum stat_counter
+  { count_query, count_candidate, count_edge_removed, count_sift,
+    count_assignment, n_counters };
+enum stat_timer
+  { timer_raster, timer_mappings, timer_inversion, timer_cleanup,
+    timer_priority, timer_assign, n_timers };
+const char *counter_name[n_counters] =
+  { "queries", "candidates", "edges_removed", "pqueue_sifts", "assignments" };
+const char *timer_name[n_timers] =
+  { "time_raster", "time_mappings", "time_inversion", "time_cleanup",
+    "time_priority", "time_assign" };
+
+/*! Common storage of the statistics of all threads working for an ETSStats
+    object. */
+struct stats_sink
+  {
+  std::mutex mtx;
+  uint64_t count[n_counters]={}, nsec[n_timers]={};
+  };
+
+#ifdef ETS_STATS
+/*! Statistics of the current thread which have not yet been added to its
+    sink. */
+struct stats_local
+  {
+  stats_sink *sink=nullptr;
+  uint64_t count[n_counters]={}, nsec[n_timers]={};
+
+  void flush()
+    {
+    if (!sink) return;
+    std::lock_guard<std::mutex> lock(sink->mtx);
+    for (size_t i=0; i<n_counters; ++i)
+      { sink->count[i]+=count[i]; count[i]=0; }
+    for (size_t i=0; i<n_timers; ++i)
+      { sink->nsec[i]+=nsec[i]; nsec[i]=0; }
+    }
+  };
+thread_local stats_local stats_tls;
+
+inline stats_sink *current_stats_sink() { return stats_tls.sink; }
+inline void add_count (stat_counter c, uint64_t n)
+  { if (stats_tls.sink) stats_tls.count[c]+=n; }
+
+/*! Directs the statistics of the calling thread to \a sink during its
+    lifetime. */
+class stats_binding
+  {
+  private:
+    stats_sink *prev;
+
+  public:
+    explicit stats_binding (stats_sink *sink)
+      {
+      stats_tls.flush();
+      prev=stats_tls.sink;
+      stats_tls.sink=sink;
+      }
+    stats_binding (const stats_binding &) = delete;
+    stats_binding &operator= (const stats_binding &) = delete;
+    ~stats_binding()
+      {
+      stats_tls.flush();
+      stats_tls.sink=prev;
+      }
+  };
+
+/*! Adds the time of its lifetime to a timer. */
+class scoped_timer
+  {
+  private:
+    stat_timer t;
+    std::chrono::steady_clock::time_point t0;
+
+  public:
+    explicit scoped_timer (stat_timer t_)
+      : t(t_), t0(std::chrono::steady_clock::now()) {}
+    ~scoped_timer()
+      {
+      if (stats_tls.sink)
+        stats_tls.nsec[t]+=std::chrono::duration_cast<std::chrono::nanoseconds>
+          (std::chrono::steady_clock::now()-t0).count();
+      }
+  };
+
+/*! Counts events locally and adds them to a counter on destruction; meant for
+    inner loops. */
+class stat_tally
+  {
+  private:
+    stat_counter c;
+    uint64_t n=0;
+
+  public:
+    explicit stat_tally (stat_counter c_) : c(c_) {}
+    ~stat_tally() { add_count(c,n); }
+    void operator++ () { ++n; }
+  };
+#else
+inline stats_sink *current_stats_sink() { return nullptr; }
+inline void add_count (stat_counter, uint64_t) {}
+struct stats_binding
+  { explicit stats_binding (stats_sink *) {} };
+struct scoped_timer
+  { explicit scoped_timer (stat_timer) {} };
+struct stat_tally
+  {
+  explicit stat_tally (stat_counter) {}
+  void operator++ () {}
+  };
+#endif
+
 inline vec2 elbow_pos(const Cobra &c, const vec2 &tip)
   {
   vec2 pt(tip-c.center);
@@ -17,6 +142,15 @@ inline vec2 elbow_pos(const Cobra &c, const vec2 &tip)
   return vec2(x,y)*rot + c.center;
   }
 
+/*! Returns \a true if the cobra \a c can place its tip at \a pos. */
+inline bool cobra_reaches(const Cobra &c, const vec2 &pos)
+  {
+  double dsq=std::norm(c.center-pos);
+  return (dsq<=(c.l1+c.l2)*(c.l1+c.l2))
+       &&(dsq>=(c.l1-c.l2)*(c.l1-c.l2))
+       &&(std::norm(c.dotpos-pos)>=c.rdot*c.rdot);
+  }
+
 inline bool line_segment_collision (const vec2 &x1, const vec2 &x2,
   const vec2 &y, double dist)
   {
@@ -32,14 +166,133 @@ inline bool line_segment_collision (const vec2 &x1, const vec2 &x2,
   return abs(q.imag())<=dist;
   }
 
-/*! Class providing efficient queries for locations on a 2D plane */
+/* Batch versions of elbow_pos() and line_segment_collision(), operating on
+   coordinate arrays. They perform exactly the same floating-point operations
+   as the scalar functions above (which remain the reference implementation),
+   so both give bitwise identical results as long as the compiler does not
+   contract multiplications and additions into FMA instructions.
+   abs() of a complex number maps to hypot(), which has no vector equivalent
+   with identical rounding; it is therefore evaluated in a separate scalar loop.
+   With GCC on x86-64 Linux, the kernels are compiled for several instruction
+   set levels (with contraction disabled, since AVX-512 implies FMA), and the
+   best one is selected at load time. The loops are annotated for explicit
+   vectorization if OpenMP SIMD support is enabled (-fopenmp-simd). */
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) \
+  && defined(__linux__) && !defined(ETS_NO_MULTIVERSIONING)
+#define ETS_SIMD_CLONES __attribute__((target_clones("avx512f","avx2","default"),\
+  optimize("fp-contract=off")))
+#else
+#define ETS_SIMD_CLONES
+#endif
+#if defined(_OPENMP) || defined(ETS_OPENMP_SIMD)
+#define ETS_SIMD_LOOP _Pragma("omp simd")
+#else
+#define ETS_SIMD_LOOP
+#endif
+
+/*! Computes the elbow positions of the cobra \a c for the \a n tip positions
+    (\a tx[i], \a ty[i]) and stores them in (\a ex[i], \a ey[i]). */
+ETS_SIMD_CLONES void elbow_pos_batch (const Cobra &c, const double *tx,
+  const double *ty, size_t n, double * __restrict__ ex,
+  double * __restrict__ ey)
+  {
+  const double cx=c.center.x(), cy=c.center.y();
+  const double l1sq=c.l1*c.l1, dlsq=c.l2*c.l2-c.l1*c.l1;
+  for (size_t i=0; i<n; ++i) // ex temporarily holds abs(tip-center)
+    ex[i]=abs(vec2(tx[i]-cx,ty[i]-cy));
+ETS_SIMD_LOOP
+  for (size_t i=0; i<n; ++i)
+    {
+    double ptx=tx[i]-cx, pty=ty[i]-cy, apt=ex[i];
+    double rx=ptx/apt, ry=pty/apt;
+    double x=(dlsq-apt*apt)/(-2*apt);
+    double y=-sqrt(l1sq-x*x);
+    ex[i]=(x*rx-y*ry)+cx;
+    ey[i]=(x*ry+y*rx)+cy;
+    }
+  }
+
+/*! For the line segment from \a x1 to \a x2, computes for the \a n points
+    (\a px[i], \a py[i]) whether they lie closer than \a dist to the segment,
+    and stores the results in \a res[i]. */
+ETS_SIMD_CLONES void line_segment_collision_batch (const vec2 &x1,
+  const vec2 &x2, const double *px, const double *py, size_t n, double dist,
+  uint8_t * __restrict__ res)
+  {
+  auto p2 = x2-x1;
+  double ap2=abs(p2);
+  auto rot = conj(p2)/ap2;
+  const double ox=x1.x(), oy=x1.y(), rx=rot.real(), ry=rot.imag(),
+               dsq=dist*dist;
+ETS_SIMD_LOOP
+  for (size_t i=0; i<n; ++i)
+    {
+    double qx0=px[i]-ox, qy0=py[i]-oy;
+    double qx=qx0*rx-qy0*ry, qy=qx0*ry+qy0*rx;
+    bool before=(qx*qx+qy*qy)<=dsq,
+         after=((qx-ap2)*(qx-ap2)+qy*qy)<=dsq,
+         inside=abs(qy)<=dist;
+    res[i]=(qx<=0) ? before : ((qx>=ap2) ? after : inside);
+    }
+  }
+
+/* With -DETS_COMPACT_INDEX, the target and cobra indices of the internal
+   tables are stored as 32-bit integers, and the rasters keep only single
+   precision copies of the positions and refer to the original positions for
+   the exact distance tests. This roughly halves the memory of the tables for
+   very large target lists; the results are identical to the default mode. */
+#ifdef ETS_COMPACT_INDEX
+using index_t = uint32_t;
+#else
+using index_t = size_t;
+#endif
+
+/*! Fails if \a n entries cannot be addressed by index_t. */
+inline void check_index_range (size_t n)
+  {
+  planck_assert(n<=size_t(std::numeric_limits<index_t>::max()),
+    "too many entries for the compact index mode");
+  }
+
+/*! Positions stored in an array of larger objects (e.g. the \a pos members
+    of a vector of targets), which are accessed without copying them. */
+class pos_view
+  {
+  private:
+    const char *base;
+    size_t stride;
+
+  public:
+    pos_view() : base(nullptr), stride(0) {}
+    pos_view (const vec2 *first, size_t stride_)
+      : base(reinterpret_cast<const char *>(first)), stride(stride_) {}
+    explicit pos_view (const std::vector<vec2> &loc)
+      : pos_view(loc.data(), sizeof(vec2)) {}
+    const vec2 &operator[] (size_t i) const
+      { return *reinterpret_cast<const vec2 *>(base+i*stride); }
+  };
+
+/*! Class providing efficient queries for locations on a 2D plane.
+    The entries are stored in compressed form: their indices and positions
+    are sorted by raster bin, and \a ofs holds the start of every bin in these
+    arrays. Entries added after construction are kept in an unsorted tail
+    behind the last bin.
+    In compact mode (see index_t), the raster only holds the positions
+    relative to its origin in single precision, which are used to reject
+    entries quickly; the positions passed to the constructor are referenced
+    for the exact tests and must outlive the raster (see rebind()). */
 class fpraster
   {
   protected:
     double x0, y0, x1, y1, idx, idy;
     size_t nx, ny;
-    std::vector<std::vector<size_t>> data;
-    std::vector<vec2> loc;
+    std::vector<index_t> ofs, ids, slot;
+#ifdef ETS_COMPACT_INDEX
+    std::vector<float> px, py;
+    pos_view loc;
+#else
+    std::vector<double> px, py;
+#endif
 
     size_t indexx (double x) const
       { return size_t(std::max(0,std::min(int(nx)-1,int((x-x0)*idx)))); }
@@ -48,9 +301,131 @@ class fpraster
     size_t index (const vec2 &pos) const
       { return indexx(pos.x()) + nx*indexy(pos.y()); }
 
+    void set_extent (const pos_view &loc_, size_t n)
+      {
+      planck_assert(n>0,"input array too small");
+      x0=x1=loc_[0].x();
+      y0=y1=loc_[0].y();
+      for (size_t i=1; i<n; ++i)
+        {
+        x0=std::min(x0,loc_[i].x()); x1=std::max(x1,loc_[i].x());
+        y0=std::min(y0,loc_[i].y()); y1=std::max(y1,loc_[i].y());
+        }
+      if (x0==x1) x1+=1e-9;
+      if (y0==y1) y1+=1e-9;
+      }
+
+    /*! Stores the position \a pos of the entry at index \a k. */
+    void set_pos (size_t k, const vec2 &pos)
+      {
+#ifdef ETS_COMPACT_INDEX
+      px[k]=float(pos.x()-x0);
+      py[k]=float(pos.y()-y0);
+#else
+      px[k]=pos.x();
+      py[k]=pos.y();
+#endif
+      }
+
+    /*! Sorts the \a n entries in \a loc_ into the bins (stable counting
+        sort). */
+    void fill (const pos_view &loc_, size_t n)
+      {
+      planck_assert ((nx>0) && (ny>0), "bad array sizes");
+      check_index_range(n);
+      idx=nx/(x1-x0);
+      idy=ny/(y1-y0);
+      ofs.assign(nx*ny+1,0);
+      std::vector<size_t> bin(n);
+      for (size_t i=0; i<n; ++i)
+        ++ofs[(bin[i]=index(loc_[i]))+1];
+      for (size_t i=1; i<ofs.size(); ++i)
+        ofs[i]+=ofs[i-1];
+      ids.resize(n);
+      slot.resize(n);
+      px.resize(n);
+      py.resize(n);
+      std::vector<size_t> pos(ofs.begin(),ofs.end()-1);
+      for (size_t i=0; i<n; ++i)
+        {
+        size_t k=pos[bin[i]]++;
+        ids[k]=i;
+        slot[i]=k;
+        set_pos(k,loc_[i]);
+        }
+      }
+
+    /*! Query circle with the quantities needed to test entries against it. */
+    struct circle
+      {
+      double cx, cy, rsq;
+#ifdef ETS_COMPACT_INDEX
+      // center relative to the origin, and squared radius enlarged by the
+      // maximum rounding error of the stored positions
+      double ox, oy, rsqpad;
+#endif
+      };
+
+    circle make_circle (const vec2 &center, double rad) const
+      {
+      circle c;
+      c.cx=center.x(); c.cy=center.y(); c.rsq=rad*rad;
+#ifdef ETS_COMPACT_INDEX
+      c.ox=c.cx-x0; c.oy=c.cy-y0;
+      double pad=1e-6*(std::abs(c.ox)+std::abs(c.oy)+rad);
+      c.rsqpad=(rad+pad)*(rad+pad);
+#endif
+      return c;
+      }
+
+    /*! Returns \a true if the entry at index \a k lies within the circle
+        \a c, and its squared distance from the center in \a dsq. Removed
+        entries (NaN) are never within a circle. */
+    bool within (const circle &c, size_t k, double &dsq) const
+      {
+#ifdef ETS_COMPACT_INDEX
+      double dx=c.ox-px[k], dy=c.oy-py[k];
+      if (!(dx*dx+dy*dy<=c.rsqpad)) return false;
+      const vec2 &p(loc[ids[k]]);
+      dsq=(c.cx-p.x())*(c.cx-p.x())+(c.cy-p.y())*(c.cy-p.y());
+#else
+      dsq=(c.cx-px[k])*(c.cx-px[k])+(c.cy-py[k])*(c.cy-py[k]);
+#endif
+      return dsq<=c.rsq;
+      }
+    bool within (const circle &c, size_t k) const
+      { double dsq; return within(c,k,dsq); }
+
+    /*! Returns the position of the entry at index \a k; this is exact only
+        in the default mode, but always good enough for bounding boxes. */
+    double xpos (size_t k) const
+#ifdef ETS_COMPACT_INDEX
+      { return x0+px[k]; }
+#else
+      { return px[k]; }
+#endif
+    double ypos (size_t k) const
+#ifdef ETS_COMPACT_INDEX
+      { return y0+py[k]; }
+#else
+      { return py[k]; }
+#endif
+
+    /*! Returns the exact position of the entry at index \a k, or NaN if it
+        has been removed. */
+    vec2 entry_pos (size_t k) const
+#ifdef ETS_COMPACT_INDEX
+      {
+      constexpr double nan=std::numeric_limits<double>::quiet_NaN();
+      return (px[k]==px[k]) ? loc[ids[k]] : vec2(nan,nan);
+      }
+#else
+      { return vec2(px[k],py[k]); }
+#endif
+
   public:
     fpraster (const vec2 &pmin, const vec2 &pmax, size_t nx_, size_t ny_)
-      : nx(nx_),ny(ny_),data(nx*ny)
+      : nx(nx_),ny(ny_),ofs(nx*ny+1,0)
       {
       planck_assert ((nx>0) && (ny>0), "bad array sizes");
       x0=pmin.x(); y0=pmin.y();
@@ -59,47 +434,94 @@ class fpraster
       idy=ny/(y1-y0);
       }
     /*! Constructs an \a fpraster with \a nx_ bins in x direction and
-        \a ny_ bins in y direction, and sorts the entries in \a loc_ into this
-        structure. */
-    fpraster (const std::vector<vec2> &loc_, size_t nx_, size_t ny_)
-      : nx(nx_),ny(ny_),data(nx*ny), loc(loc_)
+        \a ny_ bins in y direction, and sorts the \a n entries in \a loc_
+        into this structure. */
+    fpraster (const pos_view &loc_, size_t n, size_t nx_, size_t ny_)
+      : nx(nx_),ny(ny_)
       {
-      planck_assert ((nx>0) && (ny>0), "bad array sizes");
-      planck_assert(loc.size()>0,"input array too small");
-      x0=x1=loc[0].x();
-      y0=y1=loc[0].y();
-      for (size_t i=1; i<loc.size(); ++i)
-        {
-        x0=std::min(x0,loc[i].x()); x1=std::max(x1,loc[i].x());
-        y0=std::min(y0,loc[i].y()); y1=std::max(y1,loc[i].y());
-        }
-      if (x0==x1) x1+=1e-9;
-      if (y0==y1) y1+=1e-9;
-      idx=nx/(x1-x0);
-      idy=ny/(y1-y0);
-      for (size_t i=0; i<loc.size(); ++i)
-        data[index(loc[i])].push_back(i);
+      set_extent(loc_,n);
+      fill(loc_,n);
+      rebind(loc_);
+      }
+    /*! Constructs an \a fpraster for the \a n entries in \a loc_, choosing
+        the number of bins from the density of the entries and the typical
+        query radius \a rad: bins are made large enough to hold a few entries
+        on average, but not much smaller than half the query radius. */
+    fpraster (const pos_view &loc_, size_t n, double rad)
+      {
+      set_extent(loc_,n);
+      constexpr double occupancy=4.; // desired average number of entries/bin
+      double area=(x1-x0)*(y1-y0);
+      double binsize=std::max(sqrt(occupancy*area/n), 0.5*rad);
+      nx=size_t(std::max(1.,std::min(4096.,ceil((x1-x0)/binsize))));
+      ny=size_t(std::max(1.,std::min(4096.,ceil((y1-y0)/binsize))));
+      fill(loc_,n);
+      rebind(loc_);
       }
+    fpraster (const std::vector<vec2> &loc_, size_t nx_, size_t ny_)
+      : fpraster(pos_view(loc_), loc_.size(), nx_, ny_) {}
+    fpraster (const std::vector<vec2> &loc_, double rad)
+      : fpraster(pos_view(loc_), loc_.size(), rad) {}
+    /*! Informs the raster that the positions of its entries are now found
+        in \a loc_ (e.g. after the array holding them has been reallocated).
+        This is only relevant in compact mode. */
+#ifdef ETS_COMPACT_INDEX
+    void rebind (const pos_view &loc_) { loc=loc_; }
+#else
+    void rebind (const pos_view &) {}
+#endif
+    /*! Adds an entry at \a pos; its index is the number of entries
+        added so far (including removed ones). In compact mode, the raster
+        must be rebound to positions including the new entry. */
     void add (const vec2 &pos)
       {
-      loc.push_back(pos);
-      data[index(pos)].push_back(loc.size()-1);
+      check_index_range(ids.size()+1);
+      slot.push_back(ids.size());
+      ids.push_back(ids.size());
+      px.push_back(0);
+      py.push_back(0);
+      set_pos(ids.size()-1,pos);
+      }
+    /*! Removes the entry with index \a id; it is no longer returned by any
+        query. The indices of the other entries are not changed. */
+    void remove (size_t id)
+      {
+      planck_assert(id<slot.size(), "bad entry index");
+      px[slot[id]]=py[slot[id]]=std::numeric_limits<float>::quiet_NaN();
+      }
+    /*! Returns the number of entries added after construction; these are
+        not sorted into the bins and have to be checked by every query. */
+    size_t ntail() const { return ids.size()-ofs.back(); }
+    /*! Calls \a func with the index of every \a loc entry that lies within
+        a circle of radius \a rad around \a center. Entries are visited in
+        raster order, and no memory is allocated. */
+    template<typename Func> void visit(const vec2 &center, double rad,
+      Func &&func) const
+      {
+      add_count(count_query,1);
+      if ((center.x()<x0-rad)||(center.x()>x1+rad)
+        ||(center.y()<y0-rad)||(center.y()>y1+rad))
+        return;
+      auto c=make_circle(center,rad);
+      size_t i0=indexx(c.cx-rad), i1=indexx(c.cx+rad),
+             j0=indexy(c.cy-rad), j1=indexy(c.cy+rad);
+      stat_tally ncand(count_candidate);
+      for (size_t j=j0; j<=j1; ++j)
+        for (size_t k=ofs[i0+nx*j]; k<ofs[i1+1+nx*j]; ++k)
+          { ++ncand; if (within(c,k)) func(size_t(ids[k])); }
+      for (size_t k=ofs.back(); k<ids.size(); ++k)
+        { ++ncand; if (within(c,k)) func(size_t(ids[k])); }
       }
+    /*! Appends the indices of all \a loc entries that lie within a circle of
+        radius \a rad around \a center to \a res. */
+    void query(const vec2 &center, double rad, std::vector<size_t> &res) const
+      { visit(center, rad, [&res](size_t k){ res.push_back(k); }); }
     /*! Returns the indices of all \a loc entries that lie within a circle of
         radius \a rad around \a center. */
     std::vector<size_t> query(const vec2 &center, double rad) const
       {
       std::vector<size_t> res;
-      if ((center.x()<x0-rad)||(center.x()>x1+rad)
-        ||(center.y()<y0-rad)||(center.y()>y1+rad))
-        return res;
-      double rsq=rad*rad;
-      size_t i0=indexx(center.x()-rad), i1=indexx(center.x()+rad),
-            j0=indexy(center.y()-rad), j1=indexy(center.y()+rad);
-      for (size_t j=j0; j<=j1; ++j)
-        for (size_t i=i0; i<=i1; ++i)
-          for (auto k : data[i+nx*j])
-            if (std::norm(center-loc[k])<=rsq) res.push_back(k);
+      query(center, rad, res);
       return res;
       }
     bool anyIn (const vec2 &center, double rad) const
@@ -107,309 +529,262 @@ class fpraster
       if ((center.x()<x0-rad)||(center.x()>x1+rad)
         ||(center.y()<y0-rad)||(center.y()>y1+rad))
         return false;
-      double rsq=rad*rad;
-      size_t i0=indexx(center.x()-rad), i1=indexx(center.x()+rad),
-             j0=indexy(center.y()-rad), j1=indexy(center.y()+rad);
+      auto c=make_circle(center,rad);
+      size_t i0=indexx(c.cx-rad), i1=indexx(c.cx+rad),
+             j0=indexy(c.cy-rad), j1=indexy(c.cy+rad);
       for (size_t j=j0; j<=j1; ++j)
-        for (size_t i=i0; i<=i1; ++i)
-          for (auto k : data[i+nx*j])
-            if (std::norm(center-loc[k])<=rsq) return true;
+        for (size_t k=ofs[i0+nx*j]; k<ofs[i1+1+nx*j]; ++k)
+          if (within(c,k)) return true;
+      for (size_t k=ofs.back(); k<ids.size(); ++k)
+        if (within(c,k)) return true;
       return false;
       }
+    /*! Returns the number of raster bins. Entries added after construction
+        are treated as an additional bin with index nbins(). */
+    size_t nbins() const { return nx*ny; }
+    /*! Calls \a func(i, j, dsq) for every entry i in the bins [blo; bhi[ and
+        every entry j within a distance \a rad of i (including i itself), where
+        dsq is the squared distance between both. All entries of a bin share
+        one set of candidate bins, which is traversed row by row, so that the
+        candidates stay in cache while the bin is processed. For a given i,
+        the entries j are visited in the same order as by visit(). Only
+        entries i of the given bins are passed as first argument, so
+        disjoint bin ranges can be processed concurrently if \a func only
+        writes to data belonging to i. */
+    template<typename Func> void visit_pairs (size_t blo, size_t bhi,
+      double rad, Func &&func) const
+      {
+      for (size_t b=blo; b<bhi; ++b)
+        {
+        size_t klo=(b<nx*ny) ? ofs[b] : ofs.back(),
+               khi=(b<nx*ny) ? ofs[b+1] : ids.size();
+        // bounding box of the bin's entries; removed entries (NaN) fail all
+        // comparisons and are ignored
+        constexpr double inf=std::numeric_limits<double>::infinity();
+        double bx0=inf, bx1=-inf, by0=inf, by1=-inf;
+        for (size_t k=klo; k<khi; ++k)
+          {
+          double x=xpos(k), y=ypos(k);
+          if (x<bx0) bx0=x;
+          if (x>bx1) bx1=x;
+          if (y<by0) by0=y;
+          if (y>by1) by1=y;
+          }
+        if (!(bx0<=bx1)) continue; // no entries left in this bin
+        add_count(count_query,khi-klo);
+        stat_tally ncand(count_candidate);
+#ifdef ETS_COMPACT_INDEX
+        // enlarge the box by the maximum rounding error of the positions
+        double r=rad+1e-6*(std::abs(bx0-x0)+std::abs(bx1-x0)
+                          +std::abs(by0-y0)+std::abs(by1-y0));
+#else
+        double r=rad;
+#endif
+        size_t i0=indexx(bx0-r), i1=indexx(bx1+r),
+               j0=indexy(by0-r), j1=indexy(by1+r);
+        for (size_t j=j0; j<=j1; ++j)
+          for (size_t k=klo; k<khi; ++k)
+            {
+            auto c=make_circle(entry_pos(k),rad);
+            for (size_t m=ofs[i0+nx*j]; m<ofs[i1+1+nx*j]; ++m)
+              {
+              ++ncand;
+              double dsq;
+              if (within(c,m,dsq)) func(size_t(ids[k]),size_t(ids[m]),dsq);
+              }
+            }
+        for (size_t k=klo; k<khi; ++k)
+          {
+          auto c=make_circle(entry_pos(k),rad);
+          for (size_t m=ofs.back(); m<ids.size(); ++m)
+            {
+            ++ncand;
+            double dsq;
+            if (within(c,m,dsq)) func(size_t(ids[k]),size_t(ids[m]),dsq);
+            }
+          }
+        }
+      }
   };
 
-/*! Remove a given value from a vector of integers. Assert that exactly one
-    value was removed. */
-inline void stripout (std::vector<size_t> &v, size_t val)
-  {
-  size_t s1=v.size();
-  v.erase(std::remove(v.begin(),v.end(),val));
-  planck_assert(v.size()+1==s1,"oops");
-  }
-
-fpraster tgt2raster (const vector<Target> &tgt, int nx, int ny)
-  {
-  vector<vec2> tpos(tgt.size());
-  for (size_t i=0; i<tgt.size(); ++i) tpos[i]=tgt[i].pos;
-  return fpraster (tpos,nx,ny);
-  }
-
-fpraster cbr2raster (const vector<Cobra> &cbr, int nx, int ny)
-  {
-  vector<vec2> cpos(cbr.size());
-  for (size_t i=0; i<cbr.size(); ++i) cpos[i]=cbr[i].center;
-  return fpraster (cpos,nx,ny);
-  }
-
-constexpr double r_kernel=4.75; // radius of the priority function kernel
-inline double kernelfunc(double rsq)
+/*! Returns the number of threads to use for a requested thread count of
+    \a nthreads; 0 means one thread per hardware thread. */
+inline size_t get_nthreads (size_t nthreads)
   {
-  // simple parabola - quick but probably not optimal
-  return std::max(0.,r_kernel*r_kernel-rsq);
-//  return sqrt(max(0.,r_kernel*r_kernel-rsq)); // linear decrease
-//  return exp(-9*rsq/(r_kernel*r_kernel)); // Gaussian kernel
+  if (nthreads!=0) return nthreads;
+  return std::max<size_t>(1,std::thread::hardware_concurrency());
   }
 
-class ETS_data
+/*! Calls \a func(lo,hi) for consecutive index ranges of length \a chunk
+    (the last one may be shorter) covering [0; \a n[, using \a nthreads
+    threads. The ranges are handed out dynamically, so \a func must be safe to
+    call concurrently for different ranges. Exceptions thrown by \a func are
+    rethrown in the calling thread. */
+template<typename Func> void parallel_ranges (size_t n, size_t nthreads,
+  size_t chunk, Func &&func)
   {
-  protected:
-    const std::vector<Target> &tgt;
-    const std::vector<Cobra> &cbr;
-    fpraster rtgt, rcbr;
-    std::vector<std::vector<size_t>> f2t,t2f;
-    double colldist, rmax;
-
-    /*! Computes the fiber->target and target->fiber mappings. */
-    void calcMappings()
+  nthreads=get_nthreads(nthreads);
+  chunk=std::max<size_t>(1,chunk);
+  if ((nthreads==1)||(n<=chunk))
+    {
+    for (size_t lo=0; lo<n; lo+=chunk)
+      func(lo,std::min(n,lo+chunk));
+    return;
+    }
+  std::atomic<size_t> next(0);
+  std::exception_ptr ex;
+  std::mutex mtx;
+  stats_sink *sink=current_stats_sink();
+  auto worker = [&]()
+    {
+    stats_binding binding(sink); // the workers report to the caller's stats
+    try
       {
-      f2t=std::vector<std::vector<size_t>>(cbr.size());
-      for (size_t i=0; i<cbr.size(); ++i)
-        {
-        const auto &c(cbr[i]);
-        std::vector<size_t> tmp=rtgt.query(c.center,c.l1+c.l2);
-        for (auto j : tmp)
-          if ((std::norm(c.dotpos-tgt[j].pos)>=c.rdot*c.rdot)
-            &&(std::norm(c.center-tgt[j].pos)>=(c.l1-c.l2)*(c.l1-c.l2)))
-            f2t[i].push_back(j);
-        }
-      t2f=std::vector<std::vector<size_t>>(tgt.size());
-      for (size_t i=0; i<f2t.size(); ++i)
-        for (auto t : f2t[i])
-          t2f[t].push_back(i);
+      size_t lo;
+      while ((lo=next.fetch_add(chunk))<n)
+        func(lo,std::min(n,lo+chunk));
       }
-
-    int maxpri_in_fiber (size_t fiber) const
+    catch (...)
       {
-      using namespace std;
-      constexpr auto randseed=42;
-      static std::mt19937 engine{randseed};
-
-      planck_assert(!f2t[fiber].empty(), "searching in empty fiber");
-      vector<size_t> tmp;
-      int maxpri = tgt[f2t[fiber][0]].pri;
-      tmp.push_back(0);
-      for (size_t j=1; j<f2t[fiber].size(); ++j)
-        {
-        if (tgt[f2t[fiber][j]].pri==maxpri)
-          tmp.push_back(j);
-        else if (tgt[f2t[fiber][j]].pri<maxpri)
-          {
-          maxpri=tgt[f2t[fiber][j]].pri;
-          tmp.clear();
-          tmp.push_back(j);
-          }
-        }
-      std::uniform_int_distribution<size_t> dist(0, tmp.size() - 1);
-      return f2t[fiber][tmp[dist(engine)]];
+      std::lock_guard<std::mutex> lock(mtx);
+      if (!ex) ex=std::current_exception();
+      next=n;
       }
+    };
+  std::vector<std::thread> threads;
+  for (size_t i=1; i<std::min(nthreads,(n+chunk-1)/chunk); ++i)
+    threads.emplace_back(worker);
+  worker();
+  for (auto &t : threads) t.join();
+  if (ex) std::rethrow_exception(ex);
+  }
 
-    int maxpri_in_fiber_closest (size_t fiber) const
+/*! Sorts the indices of the entries of \a key, whose values must lie in
+    [0; \a nkey[, by key value. On return, the indices of all entries with
+    key value \a j are found in ascending order at the positions
+    [ofs[j]; ofs[j+1][ of \a idx.
+    This is a stable two-pass counting sort: the entries are first scattered
+    into blocks of consecutive key values, and every block is then
+    distributed independently, so that no two threads write to the same
+    output entry. */
+template<typename I> void sort_by_key (const std::vector<I> &key,
+  size_t nkey, size_t nthreads, std::vector<I> &ofs, std::vector<I> &idx)
+  {
+  scoped_timer timer(timer_inversion);
+  constexpr size_t bsize=1024; // key values per block
+  size_t n=key.size(), nblk=(nkey+bsize-1)/bsize;
+  nthreads=get_nthreads(nthreads);
+  size_t chunk=std::max<size_t>(1,(n+nthreads-1)/nthreads),
+         nchunk=(n+chunk-1)/chunk;
+  // count the entries of every input chunk falling into every block
+  std::vector<size_t> cnt(nchunk*nblk+1,0);
+  parallel_ranges(n, nthreads, chunk, [&](size_t lo, size_t hi)
+    {
+    size_t *c=&cnt[(lo/chunk)*nblk];
+    for (size_t i=lo; i<hi; ++i)
+      ++c[key[i]/bsize];
+    });
+  // convert to starting offsets, ordered by block first and chunk second
+  std::vector<size_t> bofs(nblk+1);
+  size_t sum=0;
+  for (size_t b=0; b<nblk; ++b)
+    {
+    bofs[b]=sum;
+    for (size_t p=0; p<nchunk; ++p)
       {
-      using namespace std;
-      vec2 fpos=cbr[fiber].center;
-      int maxpri = tgt[f2t[fiber][0]].pri;
-      double mindsq=std::norm(fpos-tgt[f2t[fiber][0]].pos);
-      size_t idx=0;
-      for (size_t j=1; j<f2t[fiber].size(); ++j)
-        {
-        if (tgt[f2t[fiber][j]].pri==maxpri)
-          {
-          if (std::norm(fpos-tgt[f2t[fiber][j]].pos)<mindsq)
-            { idx=j; mindsq=std::norm(fpos-tgt[f2t[fiber][j]].pos); }
-          }
-        else if (tgt[f2t[fiber][j]].pri<maxpri)
-          {
-          maxpri=tgt[f2t[fiber][j]].pri;
-          idx=j;
-          mindsq=std::norm(fpos-tgt[f2t[fiber][j]].pos);
-          }
-        }
-      return f2t[fiber][idx];
+      size_t tmp=cnt[p*nblk+b];
+      cnt[p*nblk+b]=sum;
+      sum+=tmp;
       }
-/*! Given a target index \a itgt and a fiber index \a fiber observing this
-    target, remove all references to \a itgt from the mappings and also remove
-    all targets that lie in the blocking area around \a itgt and all targets
-    exclusively visible from \a fiber. */
-    void cleanup (int fiber, int itgt)
+    }
+  bofs[nblk]=sum;
+  std::vector<size_t> tmp(n);
+  parallel_ranges(n, nthreads, chunk, [&](size_t lo, size_t hi)
+    {
+    size_t *c=&cnt[(lo/chunk)*nblk];
+    for (size_t i=lo; i<hi; ++i)
+      tmp[c[key[i]/bsize]++]=i;
+    });
+  ofs.resize(nkey+1);
+  ofs[nkey]=n;
+  idx.resize(n);
+  parallel_ranges(nblk, nthreads, 1, [&](size_t lo, size_t hi)
+    {
+    for (size_t b=lo; b<hi; ++b)
       {
-      // remove everything related to the selected fiber
-      for (auto curtgt : f2t[fiber]) stripout(t2f[curtgt],fiber);
-      f2t[fiber].clear();
-      // remove target
-      for (auto j : t2f[itgt]) stripout(f2t[j],itgt);
-      t2f[itgt].clear();
-      if (colldist>0.)
+      size_t jofs=b*bsize;
+      std::vector<size_t> pos(std::min(bsize,nkey-jofs),0);
+      for (size_t k=bofs[b]; k<bofs[b+1]; ++k)
+        ++pos[key[tmp[k]]-jofs];
+      for (size_t j=0, p=bofs[b]; j<pos.size(); ++j)
         {
-        // remove everything in "lower arm" area of the assigned cobra
-        vec2 tippos (tgt[itgt].pos),
-             elbowpos(elbow_pos(cbr[fiber], tippos));
-        std::vector<size_t> tmp=rtgt.query(0.5*(tippos+elbowpos),
-             colldist+0.5*cbr[fiber].l2);
-        for (auto i : tmp)
-          if (line_segment_collision (elbowpos, tippos, tgt[i].pos, colldist))
-            {
-            for (auto j : t2f[i]) stripout(f2t[j],i);
-            t2f[i].clear();
-            }
-        // remove all other target-fiber combinations that would leave the elbow
-        // within the lower arm region of this cobra.
-        auto tmp2 = rcbr.query(0.5*(tippos+elbowpos),
-                    colldist+rmax+0.5*cbr[fiber].l2);//FIXME!!
-        for (auto i:tmp2)
-          {
-          auto cpy(f2t[i]);
-          for (auto j:cpy)
-            {
-            vec2 tippos2 (tgt[j].pos),
-                 elbowpos2(elbow_pos(cbr[i], tippos2));
-            if (line_segment_collision (elbowpos, tippos, elbowpos2, colldist)
-              ||line_segment_collision (elbowpos2, tippos2, elbowpos, colldist)
-              ||line_segment_collision (elbowpos2, tippos2, tippos, colldist))
-              {
-              stripout(f2t[i],j);
-              stripout(t2f[j],i);
-              }
-            }
-          }
+        ofs[jofs+j]=p;
+        p+=pos[j];
+        pos[j]=ofs[jofs+j];
         }
-    //  checkMappings(tgt,f2t,t2f);
-      }
-  public:
-    ETS_data(const std::vector<Target> &tgt_, const std::vector<Cobra> &cbr_,
-      double colldist_=2.)
-      : tgt(tgt_), cbr(cbr_), rtgt(tgt2raster(tgt,100,100)),
-        rcbr(cbr2raster(cbr,100,100)),colldist(colldist_)
-      {
-      calcMappings();
-      rmax=0;
-      for (auto c : cbr)
-        rmax=max(rmax,c.l1+c.l2);
+      for (size_t k=bofs[b]; k<bofs[b+1]; ++k)
+        idx[pos[key[tmp[k]]-jofs]++]=tmp[k];
       }
-    std::vector<std::vector<size_t>> F2T() const { return f2t; }
-    std::vector<std::vector<size_t>> T2F() const { return t2f; }
-  };
+    });
+  }
 
-inline void rotate (vec2 &pos, double sa, double ca)
+/*! Returns a view of the positions of \a tgt. */
+inline pos_view target_positions (const vector<Target> &tgt)
+  { return pos_view(tgt.empty() ? nullptr : &tgt[0].pos, sizeof(Target)); }
+
+fpraster tgt2raster (const vector<Target> &tgt, double rad)
   {
-  pos*=std::complex<double>(ca,sa);
+  scoped_timer timer(timer_raster);
+  return fpraster (target_positions(tgt),tgt.size(),rad);
   }
 
-/*! Computes the central fiber position in PFI coordinates, given the fiber ID.
-    Fiber ID is zero-based throughout this code, i.e. ranging from 0 to 2393. */
-vec2 id2fiberpos(int id)
+fpraster cbr2raster (const vector<Cobra> &cbr, double rad)
   {
-  int field=id/(57*14);
-  id-=field*57*14;
-  int module=id/57;
-  int cobra=id-module*57;
-  const double vspace=sqrt(0.75); // cos(30deg)
-  vec2 res (-vspace*(1.+2*module+(cobra&1)),
-            0.5+module-0.5*cobra);
-  if (field==1) rotate(res,-vspace,-0.5);
-  if (field==2) rotate(res,vspace,-0.5);
-  res*=8;
-  return res;
+  scoped_timer timer(timer_raster);
+  return fpraster (pos_view(cbr.empty() ? nullptr : &cbr[0].center,
+    sizeof(Cobra)), cbr.size(), rad);
   }
 
-/*! Computes the position of a dot center in PFI coordinates, given a fiber ID.
-    Fiber ID is zero-based throughout this code, i.e. ranging from 0 to 2393. */
-vec2 id2dotpos(int id) // id is assumed to be in [0; 2394[
+/*! Returns the largest patrol radius of all cobras in \a cbr. */
+double max_patrol_radius (const vector<Cobra> &cbr)
   {
-  const double dot_shift_y = 2.35;
-  vec2 res=id2fiberpos(id);
-  res+=vec2(0.,dot_shift_y);
+  double res=0;
+  for (const auto &c : cbr)
+    res=max(res,c.l1+c.l2);
   return res;
   }
 
-/*! Naive assignment algorithm: iterate over all fibers, and if a fiber has
-    targets in its patrol area, assign the target with the highest priority
-    to it. */
-class NaiveAssigner: public ETS_data
+constexpr double r_kernel=4.75; // radius of the priority function kernel
+
+/* Available kernels for the priority function; they are evaluated for the
+   squared distance rsq<=r_kernel^2. */
+// simple parabola - quick but probably not optimal
+struct kernel_parabola
   {
-  public:
-    NaiveAssigner (const vector<Target> &tgt_, const std::vector<Cobra> &cobras_,
-      vector<size_t> &tid, vector<size_t> &cid)
-      : ETS_data(tgt_, cobras_)
-      {
-      tid.clear(); cid.clear();
-      for (size_t fiber=0; fiber<f2t.size(); ++fiber)
-        {
-        if (f2t[fiber].empty()) continue;
-        int itgt = maxpri_in_fiber(fiber);
-        tid.push_back(itgt);
-        cid.push_back(fiber);
-        cleanup (fiber, itgt);
-        }
-      }
+  static double eval(double rsq)
+    { return std::max(0.,r_kernel*r_kernel-rsq); }
   };
-
-  /*! Assignment strategy modeled after Morales et al. 2012: MNRAS 419, 1187
-      find the fiber(s) with the smallest number of observable targets >0;
-      for the first of the returned fibers, assign the target with highest
-      priority to it; repeat until no more targets are observable. */
-class DrainingAssigner: public ETS_data
+// linear decrease
+struct kernel_linear
   {
-  public:
-    DrainingAssigner (const vector<Target> &tgt_,
-      const std::vector<Cobra> &cobras_, vector<size_t> &tid,
-      vector<size_t> &cid)
-      : ETS_data(tgt_, cobras_)
-      {
-      tid.clear(); cid.clear();
-      size_t maxtgt=0;
-      for (const auto &f:f2t)
-        maxtgt=max(maxtgt,f.size());
-
-      while (true)
-        {
-        int fiber=-1;
-        size_t mintgt=maxtgt+1;
-        for (size_t i=0; i<f2t.size(); ++i)
-          if ((f2t[i].size()<mintgt)&&(f2t[i].size()>0))
-            { fiber=i; mintgt=f2t[i].size(); }
-        if (fiber==-1) break; // assignment done
-        int itgt = maxpri_in_fiber(fiber);
-        tid.push_back(itgt);
-        cid.push_back(fiber);
-        cleanup(fiber,itgt);
-        }
-      }
+  static double eval(double rsq)
+    { return sqrt(max(0.,r_kernel*r_kernel-rsq)); }
   };
-
-  /*! Assignment strategy modeled after Morales et al. 2012: MNRAS 419, 1187
-      find the fiber(s) with the smallest number of observable targets >0;
-      for the first of the returned fibers, assign the target with highest
-      priority to it; if there is more than one of those, choose the one closest
-      to the center of the patrol area;
-      repeat until no more targets are observable. */
-class DrainingClosestAssigner: public ETS_data
+// Gaussian kernel
+struct kernel_gaussian
   {
-  public:
-    DrainingClosestAssigner (const vector<Target> &tgt_,
-      const std::vector<Cobra> &cobras_,
-      vector<size_t> &tid, vector<size_t> &cid)
-      : ETS_data(tgt_, cobras_)
-      {
-      tid.clear(); cid.clear();
-      size_t maxtgt=0;
-      for (const auto &f:f2t)
-        maxtgt=max(maxtgt,f.size());
+  static double eval(double rsq)
+    { return exp(-9*rsq/(r_kernel*r_kernel)); }
+  };
 
-      while (true)
-        {
-        int fiber=-1;
-        size_t mintgt=maxtgt+1;
-        for (size_t i=0; i<f2t.size(); ++i)
-          if ((f2t[i].size()<mintgt)&&(f2t[i].size()>0))
-            { fiber=i; mintgt=f2t[i].size(); }
-        if (fiber==-1) break; // assignment done
-        int itgt = maxpri_in_fiber_closest(fiber);
-        tid.push_back(itgt);
-        cid.push_back(fiber);
-        cleanup(fiber,itgt);
-        }
-      }
-  };
+/* The kernel is chosen at compile time, e.g. -DETS_PRIORITY_KERNEL=kernel_linear */
+#ifndef ETS_PRIORITY_KERNEL
+#define ETS_PRIORITY_KERNEL kernel_parabola
+#endif
+using priority_kernel = ETS_PRIORITY_KERNEL;
+
+inline double kernelfunc(double rsq)
+  { return priority_kernel::eval(rsq); }
 
 /*! Priority queue that allows changing the priority of its entries after
     its creation
@@ -428,6 +803,7 @@ template <typename T, typename Compare=std::less<T>> class pqueue
 
     void sift_up (size_t i)
       {
+      add_count(count_sift,1);
       size_t moving_node = idx[i];
       T moving_pri = nodes[moving_node].pri;
 
@@ -459,6 +835,7 @@ template <typename T, typename Compare=std::less<T>> class pqueue
 
     void sift_down(size_t i)
       {
+      add_count(count_sift,1);
       size_t moving_node = idx[i];
       T moving_pri = nodes[moving_node].pri;
 
@@ -527,6 +904,903 @@ template <typename T, typename Compare=std::less<T>> class pqueue
       { return idx[1]; }
   };
 
+/*! Priority queue over the entries [0; n[ whose priorities can only be
+    lowered, as an implicit 4-ary max-heap in a contiguous array. Lowering a
+    priority only stores the new value and bumps the entry's version stamp;
+    heap entries with an outdated stamp are re-keyed when they reach the
+    top. Removed entries are dropped when they reach the top, or all at once
+    when they make up half of the heap. Of several entries with equal
+    priority, the one with the lowest index is returned first. */
+template <typename T, typename Compare=std::less<T>> class lazy_heap
+  {
+  private:
+    struct node_t
+      {
+      T pri;
+      index_t entry;
+      uint32_t stamp;
+      };
+    Compare comp;
+    std::vector<node_t> heap;
+    std::vector<T> cur;
+    std::vector<uint32_t> stamp;
+    std::vector<uint8_t> present;
+    size_t nremoved=0; // removed entries still in the heap
+
+    /*! Returns \a true if \a a must be below \a b in the heap. */
+    bool below (const node_t &a, const node_t &b) const
+      {
+      if (comp(a.pri,b.pri)) return true;
+      if (comp(b.pri,a.pri)) return false;
+      return a.entry>b.entry;
+      }
+
+    void sift_up (size_t i)
+      {
+      add_count(count_sift,1);
+      node_t moving=heap[i];
+      while (i>0)
+        {
+        size_t parent=(i-1)>>2;
+        if (!below(heap[parent],moving)) break;
+        heap[i]=heap[parent];
+        i=parent;
+        }
+      heap[i]=moving;
+      }
+    void sift_down (size_t i)
+      {
+      add_count(count_sift,1);
+      node_t moving=heap[i];
+      size_t n=heap.size();
+      while (true)
+        {
+        size_t first=4*i+1;
+        if (first>=n) break;
+        size_t best=first, last=std::min(first+4,n);
+        for (size_t c=first+1; c<last; ++c)
+          if (below(heap[best],heap[c])) best=c;
+        if (!below(moving,heap[best])) break;
+        heap[i]=heap[best];
+        i=best;
+        }
+      heap[i]=moving;
+      }
+    void pop_top()
+      {
+      heap[0]=heap.back();
+      heap.pop_back();
+      if (!heap.empty()) sift_down(0);
+      }
+    /*! Drops removed entries from the top and re-keys outdated ones, until
+        the top entry is current or the heap is empty. */
+    void settle()
+      {
+      while (!heap.empty())
+        {
+        node_t &top=heap[0];
+        if (!present[top.entry])
+          { pop_top(); --nremoved; continue; }
+        if (top.stamp==stamp[top.entry]) return;
+        // the priority has only been lowered, so sifting down suffices
+        top.pri=cur[top.entry];
+        top.stamp=stamp[top.entry];
+        sift_down(0);
+        }
+      }
+    /*! Drops all removed entries, re-keys all others and rebuilds the heap
+        in linear time. */
+    void compact()
+      {
+      size_t n=0;
+      for (const auto &node : heap)
+        if (present[node.entry])
+          heap[n++]=node_t{cur[node.entry],node.entry,stamp[node.entry]};
+      heap.resize(n);
+      nremoved=0;
+      for (size_t i=(n+2)/4; i-->0;) // from the last parent to the root
+        sift_down(i);
+      }
+
+  public:
+    /*! Constructs a queue with the priorities \a pri, containing the
+        entries i with have[i]!=0. */
+    lazy_heap (const std::vector<T> &pri, const std::vector<uint8_t> &have)
+      : cur(pri), stamp(pri.size(),0), present(have)
+      {
+      check_index_range(pri.size());
+      for (size_t i=0; i<pri.size(); ++i)
+        if (present[i]) heap.push_back(node_t{pri[i],index_t(i),0});
+      compact();
+      }
+
+    /*! Returns \a true if no entries are left. */
+    bool empty()
+      { settle(); return heap.empty(); }
+    /*! Removes the entry with the highest priority from the queue and
+        returns it. The queue must not be empty. */
+    size_t pop()
+      {
+      settle();
+      size_t res=heap[0].entry;
+      present[res]=0;
+      pop_top();
+      return res;
+      }
+    /*! Returns \a true if \a i has been neither popped nor removed. */
+    bool contains (size_t i) const { return present[i]; }
+    /*! Returns the current priority of \a i. */
+    const T &priority (size_t i) const { return cur[i]; }
+    /*! Lowers the priority of \a i to \a pri. */
+    void lower_priority (size_t i, const T &pri)
+      { cur[i]=pri; ++stamp[i]; }
+    /*! Removes \a i from the queue, if it is still contained. */
+    void remove (size_t i)
+      {
+      if (!present[i]) return;
+      present[i]=0;
+      if (2*(++nremoved)>heap.size()) compact();
+      }
+  };
+
+/*! Monotonic memory resource for short-lived scratch arrays. Memory is
+    carved from a list of blocks and never returned individually; reset()
+    releases everything at once but keeps the blocks for reuse, and a scope
+    object releases everything allocated during its lifetime. Not
+    thread-safe. */
+class scratch_arena
+  {
+  private:
+    static constexpr size_t min_block=1<<16;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    std::vector<size_t> bsize;
+    size_t cur=0, used=0; // current block and number of bytes used in it
+
+  public:
+    /*! Restores the state of the arena on destruction, so that scratch
+        space allocated in a loop body is reused by the next iteration. */
+    class scope
+      {
+      private:
+        scratch_arena &arena;
+        size_t cur, used;
+
+      public:
+        explicit scope (scratch_arena &arena_)
+          : arena(arena_), cur(arena.cur), used(arena.used) {}
+        scope (const scope &) = delete;
+        scope &operator= (const scope &) = delete;
+        ~scope() { arena.cur=cur; arena.used=used; }
+      };
+
+    void *allocate (size_t n, size_t align)
+      {
+      planck_assert(align<=alignof(std::max_align_t), "unsupported alignment");
+      while (true)
+        {
+        if (cur<blocks.size())
+          {
+          size_t ofs=(used+align-1)&~(align-1);
+          if ((ofs<=bsize[cur]) && (n<=bsize[cur]-ofs))
+            {
+            used=ofs+n;
+            return blocks[cur].get()+ofs;
+            }
+          if (cur+1<blocks.size()) { ++cur; used=0; continue; }
+          }
+        // every block is at least twice as large as its predecessor
+        size_t sz=bsize.empty() ? size_t(min_block) : 2*bsize.back();
+        while (sz<n) sz*=2;
+        blocks.emplace_back(new char[sz]);
+        bsize.push_back(sz);
+        cur=blocks.size()-1;
+        used=0;
+        }
+      }
+    /*! Releases all allocations. */
+    void reset() { cur=used=0; }
+  };
+
+/*! STL allocator drawing from a scratch_arena; deallocation is a no-op. */
+template<typename T> class arena_allocator
+  {
+  public:
+    using value_type = T;
+    scratch_arena *arena;
+
+    arena_allocator (scratch_arena &arena_) : arena(&arena_) {}
+    template<typename U> arena_allocator (const arena_allocator<U> &other)
+      : arena(other.arena) {}
+
+    T *allocate (size_t n)
+      {
+      planck_assert(n<=std::numeric_limits<size_t>::max()/sizeof(T),
+        "allocation too large");
+      return static_cast<T *>(arena->allocate(n*sizeof(T), alignof(T)));
+      }
+    void deallocate (T *, size_t) {}
+  };
+template<typename T, typename U> inline bool operator==
+  (const arena_allocator<T> &a, const arena_allocator<U> &b)
+  { return a.arena==b.arena; }
+template<typename T, typename U> inline bool operator!=
+  (const arena_allocator<T> &a, const arena_allocator<U> &b)
+  { return a.arena!=b.arena; }
+
+/*! Vector in scratch space. */
+template<typename T> using arena_vector = std::vector<T, arena_allocator<T>>;
+
+/*! Key for ordering fibers by their number of observable targets; fibers
+    without observable targets are sorted last, and ties are broken by
+    \a rank (normally the fiber index). */
+using fiber_key = std::pair<size_t,size_t>;
+inline fiber_key make_fiber_key (size_t rank, size_t ntgt)
+  { return fiber_key(ntgt>0 ? ntgt : ~size_t(0), rank); }
+/*! Queue of fibers whose top entry is the fiber with the smallest
+    nonzero number of observable targets. */
+using fiber_queue = pqueue<fiber_key,std::greater<fiber_key>>;
+
+/*! Counter-based random number generator: returns 64 random bits for the
+    given \a seed and \a counter (SplitMix64). Every value is computed
+    independently, so the random decisions of an algorithm do not depend on
+    the order in which they are made. */
+inline uint64_t random_bits (uint64_t seed, uint64_t counter)
+  {
+  uint64_t z=seed+(counter+1)*0x9e3779b97f4a7c15ULL;
+  z=(z^(z>>30))*0xbf58476d1ce4e5b9ULL;
+  z=(z^(z>>27))*0x94d049bb133111ebULL;
+  return z^(z>>31);
+  }
+
+/*! Data depending only on the cobras, which can be shared by assignments
+    for different sets of targets. */
+class ETS_cobras
+  {
+  public:
+    std::vector<Cobra> cbr;
+    double rmax;
+    fpraster rcbr;
+
+    ETS_cobras (const std::vector<Cobra> &cbr_)
+      : cbr(cbr_), rmax(max_patrol_radius(cbr)), rcbr(cbr2raster(cbr,rmax)) {}
+    // the raster may refer to cbr
+    ETS_cobras (const ETS_cobras &) = delete;
+    ETS_cobras &operator= (const ETS_cobras &) = delete;
+  };
+
+/*! Data that stay the same for all assignment runs on a given set of targets
+    and cobras: the rasters and the table of all possible fiber/target
+    combinations ("edges"). The edges are sorted by fiber and then by target.
+    The edges of fiber i have the indices [fofs[i]; fofs[i+1][, and
+    etgt/efib hold their target and fiber.
+    tedge[tofs[j]] ... tedge[tofs[j+1]-1] are the edges of target j, sorted
+    by fiber. elbx/elby hold the elbow position of the cobra for every edge. */
+class ETS_tables
+  {
+  public:
+    const std::vector<Target> &tgt;
+    const std::vector<Cobra> &cbr;
+    const fpraster &rcbr;
+    double colldist, rmax;
+    size_t nthreads;
+    fpraster rtgt;
+    std::vector<index_t> fofs, etgt, efib, tofs, tedge;
+    std::vector<double> elbx, elby;
+    // targets not removed via deactivate_target()
+    std::vector<uint8_t> active;
+
+  private:
+    /*! Computes the fiber->target and target->fiber mappings.
+        Both mappings are sorted by index, so that the results do not depend on
+        the internal layout of the raster. */
+    void calcMappings()
+      {
+      {
+      scoped_timer timer(timer_mappings);
+      // every chunk of cobras collects its targets in one buffer, which
+      // avoids allocating a separate vector for every cobra
+      constexpr size_t chunk=16;
+      size_t nchunk=(cbr.size()+chunk-1)/chunk;
+      std::vector<std::vector<index_t>> part(nchunk);
+      check_index_range(cbr.size());
+      fofs.assign(cbr.size()+1,0);
+      parallel_ranges(cbr.size(), nthreads, chunk, [&](size_t lo, size_t hi)
+        {
+        auto &out(part[lo/chunk]);
+        for (size_t i=lo; i<hi; ++i)
+          {
+          const auto &c(cbr[i]);
+          size_t n0=out.size();
+          rtgt.visit(c.center,c.l1+c.l2,[&](size_t j)
+            { if (cobra_reaches(c,tgt[j].pos)) out.push_back(j); });
+          std::sort(out.begin()+n0,out.end());
+          fofs[i+1]=out.size()-n0;
+          }
+        });
+      size_t nedge=0;
+      for (const auto &p : part) nedge+=p.size();
+      check_index_range(nedge);
+      for (size_t i=0; i<cbr.size(); ++i)
+        fofs[i+1]+=fofs[i];
+      etgt.resize(fofs.back());
+      efib.resize(fofs.back());
+      elbx.resize(fofs.back());
+      elby.resize(fofs.back());
+      parallel_ranges(cbr.size(), nthreads, chunk, [&](size_t lo, size_t hi)
+        {
+        auto &in(part[lo/chunk]);
+        std::copy(in.begin(),in.end(),etgt.begin()+fofs[lo]);
+        std::vector<index_t>().swap(in);
+        std::vector<double> tx, ty;
+        for (size_t i=lo; i<hi; ++i)
+          {
+          size_t n=fofs[i+1]-fofs[i];
+          std::fill(efib.begin()+fofs[i],efib.begin()+fofs[i+1],i);
+          tx.resize(n);
+          ty.resize(n);
+          for (size_t k=0; k<n; ++k)
+            {
+            const auto &pos(tgt[etgt[fofs[i]+k]].pos);
+            tx[k]=pos.x(); ty[k]=pos.y();
+            }
+          elbow_pos_batch(cbr[i], tx.data(), ty.data(), n,
+            elbx.data()+fofs[i], elby.data()+fofs[i]);
+          }
+        });
+      }
+      sort_by_key(etgt, tgt.size(), nthreads, tofs, tedge);
+      }
+
+  public:
+    /*! Sets up the mappings between the targets \a tgt_ and the cobras
+        \a cobras. The visibility computation uses \a nthreads_ threads
+        (0 means one per hardware thread). Both arguments must outlive the
+        object. */
+    ETS_tables(const std::vector<Target> &tgt_, const ETS_cobras &cobras,
+      size_t nthreads_=1, double colldist_=2.)
+      : tgt(tgt_), cbr(cobras.cbr), rcbr(cobras.rcbr), colldist(colldist_),
+        rmax(cobras.rmax), nthreads(nthreads_), rtgt(tgt2raster(tgt,rmax)),
+        active(tgt.size(),1)
+      {
+      calcMappings();
+      }
+
+    /*! Excludes the target \a itgt from all further assignments. */
+    void deactivate_target (size_t itgt)
+      {
+      if (!active[itgt]) return;
+      active[itgt]=0;
+      rtgt.remove(itgt);
+      }
+    /*! Adds the targets [first; tgt.size()[, which have been appended to the
+        target list, to the raster and the mappings. Only the combinations of
+        the new targets are computed; the existing ones are merged. */
+    void add_targets (size_t first)
+      {
+      planck_assert(first==active.size(), "inconsistent target list");
+      {
+      scoped_timer timer(timer_mappings);
+      check_index_range(tgt.size());
+      rtgt.rebind(target_positions(tgt)); // tgt may have been reallocated
+      std::vector<std::vector<size_t>> f2t(cbr.size());
+      for (size_t t=first; t<tgt.size(); ++t)
+        {
+        rtgt.add(tgt[t].pos);
+        active.push_back(1);
+        rcbr.visit(tgt[t].pos, rmax, [&](size_t c)
+          { if (cobra_reaches(cbr[c],tgt[t].pos)) f2t[c].push_back(t); });
+        }
+      size_t nedge=etgt.size();
+      for (const auto &f : f2t) nedge+=f.size();
+      check_index_range(nedge);
+      std::vector<index_t> nfofs(cbr.size()+1,0);
+      for (size_t i=0; i<cbr.size(); ++i)
+        nfofs[i+1]=nfofs[i]+(fofs[i+1]-fofs[i])+f2t[i].size();
+      std::vector<index_t> netgt(nfofs.back()), nefib(nfofs.back());
+      std::vector<double> nelbx(nfofs.back()), nelby(nfofs.back());
+      std::vector<double> tx, ty;
+      for (size_t i=0; i<cbr.size(); ++i)
+        {
+        size_t nold=fofs[i+1]-fofs[i], nnew=f2t[i].size();
+        std::copy(etgt.begin()+fofs[i],etgt.begin()+fofs[i+1],
+          netgt.begin()+nfofs[i]);
+        std::copy(elbx.begin()+fofs[i],elbx.begin()+fofs[i+1],
+          nelbx.begin()+nfofs[i]);
+        std::copy(elby.begin()+fofs[i],elby.begin()+fofs[i+1],
+          nelby.begin()+nfofs[i]);
+        std::fill(nefib.begin()+nfofs[i],nefib.begin()+nfofs[i+1],i);
+        // new targets have larger indices, so the order is preserved
+        std::copy(f2t[i].begin(),f2t[i].end(),netgt.begin()+nfofs[i]+nold);
+        tx.resize(nnew);
+        ty.resize(nnew);
+        for (size_t k=0; k<nnew; ++k)
+          { tx[k]=tgt[f2t[i][k]].pos.x(); ty[k]=tgt[f2t[i][k]].pos.y(); }
+        elbow_pos_batch(cbr[i], tx.data(), ty.data(), nnew,
+          nelbx.data()+nfofs[i]+nold, nelby.data()+nfofs[i]+nold);
+        }
+      fofs.swap(nfofs);
+      etgt.swap(netgt);
+      efib.swap(nefib);
+      elbx.swap(nelbx);
+      elby.swap(nelby);
+      }
+      sort_by_key(etgt, tgt.size(), nthreads, tofs, tedge);
+      }
+  };
+
+/*! State of a single assignment run on a set of ETS_tables.
+    Edges are never removed from the tables; instead their \a alive flag is
+    cleared and the counts in fcnt/tcnt are decremented, so that removal is
+    O(1) and the order of the remaining edges is preserved. The tables are
+    only read, so several ETS_data objects may work on the same tables
+    concurrently, and reset() prepares an object for another run. */
+class ETS_data
+  {
+  public:
+    const ETS_tables &tab;
+    // shortcuts for the members of tab
+    const std::vector<Target> &tgt;
+    const std::vector<Cobra> &cbr;
+    const fpraster &rtgt, &rcbr;
+    const std::vector<index_t> &fofs, &etgt, &efib, &tofs, &tedge;
+    const std::vector<double> &elbx, &elby;
+    const double colldist, rmax;
+    const size_t nthreads;
+
+  private:
+    std::vector<uint8_t> alive;
+    std::vector<index_t> fcnt, tcnt;
+    bool track_fibers=false, track_targets=false;
+    std::vector<size_t> changed_fibers, lost_targets;
+    uint64_t seed=42;
+    bool perturb=false; // see perturb_order()
+    // scratch space for the batch collision tests in cleanup()
+    std::vector<size_t> sidx;
+    std::vector<double> sx, sy;
+    std::vector<uint8_t> scoll;
+    // scratch space for the assigners, released by reset()
+    mutable scratch_arena arena;
+    // limits of the current run, see set_budget()
+    bool use_deadline=false, budget_hit=false;
+    std::chrono::steady_clock::time_point deadline;
+    size_t maxassign=0, nassign=0;
+
+    /*! Records that the target list of \a fiber has changed, if change
+        tracking is enabled. */
+    void fiber_changed (size_t fiber)
+      { if (track_fibers) changed_fibers.push_back(fiber); }
+
+    /*! Removes the edge \a e from the mappings. */
+    void remove_edge (size_t e)
+      {
+      if (!alive[e]) return;
+      add_count(count_edge_removed,1);
+      alive[e]=0;
+      --fcnt[efib[e]];
+      if ((--tcnt[etgt[e]]==0) && track_targets)
+        lost_targets.push_back(etgt[e]);
+      }
+    /*! Removes all edges of \a fiber from the mappings. */
+    void remove_fiber (size_t fiber)
+      {
+      for (size_t e=fofs[fiber]; e<fofs[fiber+1]; ++e)
+        remove_edge(e);
+      fiber_changed(fiber);
+      }
+    /*! Removes all edges of \a itgt from the mappings. */
+    void remove_target (size_t itgt)
+      {
+      for (size_t k=tofs[itgt]; k<tofs[itgt+1]; ++k)
+        {
+        size_t e=tedge[k];
+        if (alive[e]) { remove_edge(e); fiber_changed(efib[e]); }
+        }
+      }
+
+  public:
+    ETS_data (const ETS_tables &tab_) : ETS_data(tab_, tab_.nthreads) {}
+    /*! As above, but the assigners use \a nthreads_ threads instead of the
+        thread count of the tables. */
+    ETS_data (const ETS_tables &tab_, size_t nthreads_)
+      : tab(tab_), tgt(tab.tgt), cbr(tab.cbr), rtgt(tab.rtgt), rcbr(tab.rcbr),
+        fofs(tab.fofs), etgt(tab.etgt), efib(tab.efib), tofs(tab.tofs),
+        tedge(tab.tedge), elbx(tab.elbx), elby(tab.elby),
+        colldist(tab.colldist), rmax(tab.rmax), nthreads(nthreads_)
+      { reset(); }
+
+    /*! Makes all fiber/target combinations available again and sets the
+        seed for random decisions to \a seed_. */
+    void reset (uint64_t seed_=42)
+      {
+      seed=seed_;
+      perturb=false;
+      arena.reset();
+      alive.assign(etgt.size(),1);
+      fcnt.resize(cbr.size());
+      for (size_t i=0; i<cbr.size(); ++i)
+        fcnt[i]=fofs[i+1]-fofs[i];
+      tcnt.resize(tgt.size());
+      for (size_t j=0; j<tgt.size(); ++j)
+        tcnt[j]=tofs[j+1]-tofs[j];
+      track_fibers=track_targets=false;
+      changed_fibers.clear();
+      lost_targets.clear();
+      clear_budget();
+      for (size_t j=0; j<tgt.size(); ++j)
+        if (!tab.active[j]) remove_target(j);
+      }
+
+    /*! Limits the following assignments to \a budget; its time limit counts
+        from \a start. */
+    void set_budget (const AssignmentBudget &budget,
+      std::chrono::steady_clock::time_point start)
+      {
+      using namespace std::chrono;
+      use_deadline=budget.seconds>0;
+      if (use_deadline)
+        deadline=start+duration_cast<steady_clock::duration>
+          (duration<double>(budget.seconds));
+      maxassign=budget.iterations;
+      nassign=0;
+      budget_hit=false;
+      }
+    /*! Removes all limits. */
+    void clear_budget()
+      { use_deadline=budget_hit=false; maxassign=0; }
+    /*! Returns \a true if the budget of the run is exhausted; the assigners
+        check this before every assignment. */
+    bool out_of_budget()
+      {
+      if (!budget_hit)
+        budget_hit = ((maxassign>0) && (nassign>=maxassign))
+          || (use_deadline && (std::chrono::steady_clock::now()>=deadline));
+      return budget_hit;
+      }
+    /*! Returns \a true if out_of_budget() has stopped the run. */
+    bool budget_exhausted() const { return budget_hit; }
+
+    /*! Returns a random number in [0; n[ which depends only on the seed and
+        on \a key; different random decisions of a run must use different
+        keys. */
+    size_t random_index (uint64_t key, size_t n) const
+      { return size_t(random_bits(seed,key)%n); }
+    /*! Makes the assigners perturb their order of processing by means of
+        order_jitter() and fiber_rank() until the next reset(), so that runs
+        with different seeds explore different assignments even for the
+        deterministic algorithms. */
+    void perturb_order() { perturb=true; }
+    /*! Returns a factor in [1; 1+1e-2[ which depends only on the seed and
+        on \a key, if perturb_order() is active, and 1 otherwise. Scaling a
+        criterion by it reorders candidates that are equal or within 1% of
+        each other. */
+    double order_jitter (uint64_t key) const
+      {
+      if (!perturb) return 1.;
+      constexpr uint64_t salt=0x5bd1e9955bd1e995ULL; // keys differ from above
+      double u=double(random_bits(seed^salt,key)>>11)/9007199254740992.;
+      return 1.+1e-2*u; // u has 53 random bits in [0; 1[
+      }
+    /*! Returns the rank of \a fiber among fibers with equally many
+        observable targets: its index, or a random value depending only
+        on the seed if perturb_order() is active. */
+    size_t fiber_rank (size_t fiber) const
+      {
+      constexpr uint64_t salt=0x9e6c63d0676a9a99ULL;
+      return perturb ? size_t(random_bits(seed^salt,fiber)) : fiber;
+      }
+
+    /*! Returns the arena for temporary arrays of the assigners; these
+        should be allocated within a scratch_arena::scope. */
+    scratch_arena &scratch() const { return arena; }
+
+    size_t nfibers() const { return fcnt.size(); }
+    /*! Returns the number of targets still observable by \a fiber. */
+    size_t fiber_count (size_t fiber) const { return fcnt[fiber]; }
+    /*! Returns the number of fibers still able to observe \a itgt. */
+    size_t target_count (size_t itgt) const { return tcnt[itgt]; }
+
+    /*! Returns a queue containing all fibers, ordered by their number of
+        observable targets, and enables change tracking for it. */
+    fiber_queue make_fiber_queue()
+      {
+      std::vector<fiber_key> keys(fcnt.size());
+      for (size_t i=0; i<fcnt.size(); ++i)
+        keys[i]=make_fiber_key(fiber_rank(i),fcnt[i]);
+      track_fibers=true;
+      changed_fibers.clear();
+      return fiber_queue(keys);
+      }
+    /*! Updates \a queue for all fibers changed since the last call. */
+    void update_fiber_queue (fiber_queue &queue)
+      {
+      for (auto f : changed_fibers)
+        queue.set_priority(make_fiber_key(fiber_rank(f),fcnt[f]),f);
+      changed_fibers.clear();
+      }
+    /*! Enables recording of the targets that become unobservable. */
+    void track_lost_targets()
+      { track_targets=true; lost_targets.clear(); }
+    /*! Calls \a func with every target that has become unobservable since
+        the last call. */
+    template<typename Func> void for_lost_targets (Func &&func)
+      {
+      for (auto t : lost_targets) func(t);
+      lost_targets.clear();
+      }
+    /*! Returns the fiber with the smallest nonzero number of observable
+        targets (the one with the lowest index, or a random one with
+        perturb_order(), if there are several), or -1
+        if no fiber has observable targets left. */
+    int min_fiber (const fiber_queue &queue) const
+      {
+      if (fcnt.empty() || (fcnt[queue.top()]==0)) return -1;
+      return int(queue.top());
+      }
+
+    /*! Calls \a func with every target still observable by \a fiber, in
+        ascending order. */
+    template<typename Func> void for_targets_of (size_t fiber, Func &&func)
+      const
+      {
+      for (size_t e=fofs[fiber]; e<fofs[fiber+1]; ++e)
+        if (alive[e]) func(etgt[e]);
+      }
+    /*! Calls \a func with every fiber still able to observe \a itgt, in
+        ascending order. */
+    template<typename Func> void for_fibers_of (size_t itgt, Func &&func)
+      const
+      {
+      for (size_t k=tofs[itgt]; k<tofs[itgt+1]; ++k)
+        if (alive[tedge[k]]) func(efib[tedge[k]]);
+      }
+    /*! Returns the index of the edge between \a fiber and \a itgt, which must
+        exist. */
+    size_t edge_index (size_t fiber, size_t itgt) const
+      {
+      auto it=std::lower_bound(etgt.begin()+fofs[fiber],
+        etgt.begin()+fofs[fiber+1], itgt);
+      planck_assert((it!=etgt.begin()+fofs[fiber+1])&&(*it==itgt),
+        "target not visible by fiber");
+      return it-etgt.begin();
+      }
+    /*! Returns \a true if \a fiber can still observe \a itgt. */
+    bool can_observe (size_t fiber, size_t itgt) const
+      {
+      auto it=std::lower_bound(etgt.begin()+fofs[fiber],
+        etgt.begin()+fofs[fiber+1], itgt);
+      return (it!=etgt.begin()+fofs[fiber+1]) && (*it==itgt)
+          && alive[it-etgt.begin()];
+      }
+    /*! Returns the cached elbow position for the edge \a e. */
+    vec2 elbow (size_t e) const
+      { return vec2(elbx[e],elby[e]); }
+
+/*! Given a target index \a itgt and a fiber index \a fiber observing this
+    target, remove all references to \a itgt from the mappings and also remove
+    all targets that lie in the blocking area around \a itgt and all targets
+    exclusively visible from \a fiber. */
+    void cleanup (int fiber, int itgt)
+      {
+      scoped_timer timer(timer_cleanup);
+      ++nassign;
+      size_t iedge=edge_index(fiber,itgt);
+      // remove everything related to the selected fiber
+      remove_fiber(fiber);
+      // remove target
+      remove_target(itgt);
+      if (colldist>0.)
+        {
+        // remove everything in "lower arm" area of the assigned cobra
+        vec2 tippos (tgt[itgt].pos),
+             elbowpos(elbow(iedge));
+        sidx.clear(); sx.clear(); sy.clear();
+        rtgt.visit(0.5*(tippos+elbowpos), colldist+0.5*cbr[fiber].l2,
+          [&](size_t i)
+          {
+          sidx.push_back(i);
+          sx.push_back(tgt[i].pos.x());
+          sy.push_back(tgt[i].pos.y());
+          });
+        scoll.resize(sidx.size());
+        line_segment_collision_batch (elbowpos, tippos, sx.data(), sy.data(),
+          sidx.size(), colldist, scoll.data());
+        for (size_t k=0; k<sidx.size(); ++k)
+          if (scoll[k]) remove_target(sidx[k]);
+        // remove all other target-fiber combinations that would leave the elbow
+        // within the lower arm region of this cobra.
+        rcbr.visit(0.5*(tippos+elbowpos), colldist+rmax+0.5*cbr[fiber].l2,
+          [&](size_t i) //FIXME!!
+          {
+          size_t e0=fofs[i], ne=fofs[i+1]-fofs[i];
+          scoll.resize(ne);
+          line_segment_collision_batch (elbowpos, tippos, elbx.data()+e0,
+            elby.data()+e0, ne, colldist, scoll.data());
+          for (size_t e=fofs[i]; e<fofs[i+1]; ++e)
+            {
+            if (!alive[e]) continue;
+            vec2 tippos2 (tgt[etgt[e]].pos),
+                 elbowpos2(elbow(e));
+            if (scoll[e-e0]
+              ||line_segment_collision (elbowpos2, tippos2, elbowpos, colldist)
+              ||line_segment_collision (elbowpos2, tippos2, tippos, colldist))
+              {
+              remove_edge(e);
+              fiber_changed(i);
+              }
+            }
+          });
+        }
+      }
+    std::vector<std::vector<size_t>> F2T() const
+      {
+      std::vector<std::vector<size_t>> res(fcnt.size());
+      for (size_t i=0; i<res.size(); ++i)
+        {
+        res[i].reserve(fcnt[i]);
+        for_targets_of(i,[&](size_t t){ res[i].push_back(t); });
+        }
+      return res;
+      }
+    std::vector<std::vector<size_t>> T2F() const
+      {
+      std::vector<std::vector<size_t>> res(tcnt.size());
+      for (size_t i=0; i<res.size(); ++i)
+        {
+        res[i].reserve(tcnt[i]);
+        for_fibers_of(i,[&](size_t f){ res[i].push_back(f); });
+        }
+      return res;
+      }
+  };
+
+inline void rotate (vec2 &pos, double sa, double ca)
+  {
+  pos*=std::complex<double>(ca,sa);
+  }
+
+/*! Computes the central fiber position in PFI coordinates, given the fiber ID.
+    Fiber ID is zero-based throughout this code, i.e. ranging from 0 to 2393. */
+vec2 id2fiberpos(int id)
+  {
+  int field=id/(57*14);
+  id-=field*57*14;
+  int module=id/57;
+  int cobra=id-module*57;
+  const double vspace=sqrt(0.75); // cos(30deg)
+  vec2 res (-vspace*(1.+2*module+(cobra&1)),
+            0.5+module-0.5*cobra);
+  if (field==1) rotate(res,-vspace,-0.5);
+  if (field==2) rotate(res,vspace,-0.5);
+  res*=8;
+  return res;
+  }
+
+/*! Computes the position of a dot center in PFI coordinates, given a fiber ID.
+    Fiber ID is zero-based throughout this code, i.e. ranging from 0 to 2393. */
+vec2 id2dotpos(int id) // id is assumed to be in [0; 2394[
+  {
+  const double dot_shift_y = 2.35;
+  vec2 res=id2fiberpos(id);
+  res+=vec2(0.,dot_shift_y);
+  return res;
+  }
+
+/* Building blocks for greedy assignment strategies (see assign_greedy()).
+
+   A fiber order policy decides which fiber receives the next target:
+     FiberOrder(ETS_data &d);     // prepares the order for a run on d
+     int next(ETS_data &d);       // next fiber, or -1 if assignment is done
+   A target selection policy chooses the target for this fiber:
+     static size_t select(const ETS_data &d, size_t fiber);
+   A tie-break policy chooses among several equally suitable targets:
+     static size_t select(const ETS_data &d, size_t fiber,
+                          const arena_vector<size_t> &candidates); */
+
+/*! Processes the fibers in order of increasing index, skipping fibers
+    without observable targets. */
+class fibers_by_index
+  {
+  private:
+    size_t cur=0;
+
+  public:
+    fibers_by_index (ETS_data &) {}
+    int next (ETS_data &d)
+      {
+      while ((cur<d.nfibers()) && (d.fiber_count(cur)==0)) ++cur;
+      return (cur<d.nfibers()) ? int(cur++) : -1;
+      }
+  };
+
+/*! Always processes the fiber with the smallest nonzero number of observable
+    targets next (the one with the lowest index, if there are several). */
+class fibers_draining
+  {
+  private:
+    fiber_queue queue;
+
+  public:
+    fibers_draining (ETS_data &d) : queue(d.make_fiber_queue()) {}
+    int next (ETS_data &d)
+      {
+      d.update_fiber_queue(queue);
+      return d.min_fiber(queue);
+      }
+  };
+
+/*! Chooses one of the candidates at random. Every fiber receives at most one
+    target per run, so the fiber index serves as the key of the decision. */
+struct tiebreak_random
+  {
+  static size_t select (const ETS_data &d, size_t fiber,
+    const arena_vector<size_t> &cand)
+    { return cand[d.random_index(fiber, cand.size())]; }
+  };
+
+/*! Chooses the candidate closest to the center of the fiber's patrol area
+    (the first one, if there are several). */
+struct tiebreak_closest
+  {
+  static size_t select (const ETS_data &d, size_t fiber,
+    const arena_vector<size_t> &cand)
+    {
+    vec2 fpos=d.cbr[fiber].center;
+    size_t res=cand[0];
+    double mindsq=std::norm(fpos-d.tgt[res].pos)*d.order_jitter(res);
+    for (size_t i=1; i<cand.size(); ++i)
+      {
+      double dsq=std::norm(fpos-d.tgt[cand[i]].pos)*d.order_jitter(cand[i]);
+      if (dsq<mindsq) { res=cand[i]; mindsq=dsq; }
+      }
+    return res;
+    }
+  };
+
+/*! Chooses the target with the highest priority (i.e. the lowest \a pri
+    value) among those observable by the fiber; ties are resolved by
+    \a TieBreak. */
+template<typename TieBreak> struct target_maxpri
+  {
+  static size_t select (const ETS_data &d, size_t fiber)
+    {
+    planck_assert(d.fiber_count(fiber)>0, "searching in empty fiber");
+    scratch_arena::scope scope(d.scratch());
+    arena_vector<size_t> tmp(d.scratch());
+    int maxpri = numeric_limits<int>::max();
+    d.for_targets_of(fiber, [&](size_t t)
+      {
+      if (d.tgt[t].pri==maxpri)
+        tmp.push_back(t);
+      else if (d.tgt[t].pri<maxpri)
+        {
+        maxpri=d.tgt[t].pri;
+        tmp.clear();
+        tmp.push_back(t);
+        }
+      });
+    return TieBreak::select(d, fiber, tmp);
+    }
+  };
+
+/*! Greedy assignment: lets \a FiberOrder pick a fiber and \a TargetChoice one
+    of its targets, assigns that target to the fiber and removes all
+    combinations made impossible by this, until no more targets are
+    observable or the budget of \a d is exhausted. */
+template<typename FiberOrder, typename TargetChoice> void assign_greedy
+  (ETS_data &d, std::vector<size_t> &tid, std::vector<size_t> &cid)
+  {
+  tid.clear(); cid.clear();
+  FiberOrder order(d);
+  int fiber;
+  while ((!d.out_of_budget()) && ((fiber=order.next(d))!=-1))
+    {
+    size_t itgt=TargetChoice::select(d, fiber);
+    tid.push_back(itgt);
+    cid.push_back(fiber);
+    d.cleanup(fiber, itgt);
+    }
+  }
+
 struct pq_entry
   {
   double prox;
@@ -542,84 +1816,352 @@ struct pq_entry
     }
   };
 
+/*! Returns the initial target priorities of the "new" assigners. */
+std::vector<pq_entry> proximity_priorities (const ETS_data &d)
+  {
+  scoped_timer timer(timer_priority);
+  const auto &tgt(d.tgt);
+  std::vector<pq_entry> pri(tgt.size());
+  // The pair of targets i<=j contributes to the proximity of both if
+  // target i is observable. Every target gathers the contributions of its
+  // own neighbours, so that the raster bins can be processed in parallel.
+  // The sums are accumulated in raster order, which is independent of the
+  // number of threads but not the order of the original per-bin raster;
+  // rounding differences let the "new" assigners break near-ties
+  // differently than before the raster was changed to a flat layout.
+  parallel_ranges(d.rtgt.nbins()+1, d.nthreads, 16,
+    [&](size_t lo, size_t hi)
+    {
+    d.rtgt.visit_pairs(lo, hi, r_kernel,
+      [&](size_t i, size_t j, double dsq)
+      {
+      if (d.target_count(std::min(i,j))>0)
+        pri[i].prox+=tgt[i].time*tgt[j].time*kernelfunc(dsq);
+      });
+    });
+  for (size_t i=0; i<tgt.size(); ++i)
+    {
+    pri[i].prox*=d.order_jitter(i);
+    pri[i].pri=tgt[i].pri;
+    }
+  return pri;
+  }
+
+/*! Returns the fiber that observes \a itgt in the "new" assigners: the one
+    with the fewest observable targets (the first one, if there are
+    several). */
+size_t least_used_fiber (const ETS_data &d, size_t itgt)
+  {
+  size_t fiber=0, mintgt=~size_t(0);
+  d.for_fibers_of(itgt, [&](size_t f)
+    { if (d.fiber_count(f)<mintgt) { fiber=f; mintgt=d.fiber_count(f); } });
+  return fiber;
+  }
 
   /*! Assignment strategy with the goal of reducing inhomogeneity in the
       target distribution: assign a priority to each target that depends on
       the distance of all other targets in its close vicinity; process targets
       in order of decreasing priority and assign them to fibers, if possible.
       After each assignment, update the priority of the remaining targets. */
-class NewAssigner: public ETS_data
+class NewAssigner
   {
   private:
+    ETS_data &d;
+    const std::vector<Target> &tgt;
+
     pqueue<pq_entry> calc_pri() const
       {
-      std::vector<pq_entry> pri(tgt.size());
-      for (size_t i=0; i<tgt.size(); ++i)
-        {
-        if (t2f[i].size()>0)
-          {
-          std::vector<size_t> ngb = rtgt.query(tgt[i].pos,r_kernel);
-
-          for (auto j : ngb)
-            {
-            if (i==j)
-              pri[i].prox+=tgt[i].time*tgt[i].time*kernelfunc(0.);
-            if (i<j)
-              {
-              double tmp=tgt[i].time*tgt[j].time
-                        *kernelfunc(std::norm(tgt[i].pos-tgt[j].pos));
-              pri[i].prox+=tmp;
-              pri[j].prox+=tmp;
-              }
-            }
-          }
-        }
-      for (size_t i=0; i<tgt.size(); ++i)
-        pri[i].pri=tgt[i].pri;
-      pqueue<pq_entry> res(pri);
+      pqueue<pq_entry> res(proximity_priorities(d));
       return res;
       }
 
     void fix_priority(size_t itgt, pqueue<pq_entry> &pri)
       {
-      std::vector<size_t> ngb = rtgt.query(tgt[itgt].pos,r_kernel);
-      for (auto j : ngb)
-        if ((!t2f[j].empty())||(pri.priority(j).prox!=0.))
+      scoped_timer timer(timer_priority);
+      d.rtgt.visit(tgt[itgt].pos,r_kernel,[&](size_t j)
+        {
+        if ((d.target_count(j)>0)||(pri.priority(j).prox!=0.))
           {
           pq_entry tpri=pri.priority(j);
           tpri.prox-=tgt[j].time*tgt[itgt].time
                     *kernelfunc(std::norm(tgt[itgt].pos-tgt[j].pos));
           pri.set_priority(tpri,j);
           }
+        });
       }
 
   public:
-    NewAssigner (const vector<Target> &tgt_, const std::vector<Cobra> &cobras_,
-      vector<size_t> &tid, vector<size_t> &cid)
-      : ETS_data(tgt_, cobras_)
+    NewAssigner (ETS_data &d_, vector<size_t> &tid, vector<size_t> &cid)
+      : d(d_), tgt(d.tgt)
       {
       tid.clear(); cid.clear();
+      if (d.out_of_budget()) return; // don't compute unused priorities
       pqueue<pq_entry> pri=calc_pri();
 
-      while (true)
+      while (!d.out_of_budget())
         {
         if (pri.top_priority().pri==(1<<30)) break;
         size_t itgt=pri.top();
-        if (t2f[itgt].empty())
+        if (d.target_count(itgt)==0)
           { pri.set_priority(pq_entry(0.,(1<<30)),itgt); continue; }
-        size_t ifib=0, mintgt=f2t[t2f[itgt][ifib]].size();
-        for (size_t i=1; i<t2f[itgt].size(); ++i)
-          if (f2t[t2f[itgt][i]].size()<mintgt)
-            { ifib=i; mintgt=f2t[t2f[itgt][i]].size(); }
-        int fiber=t2f[itgt][ifib];
+        size_t fiber=least_used_fiber(d,itgt);
         tid.push_back(itgt);
         cid.push_back(fiber);
-        cleanup(fiber,itgt);
+        d.cleanup(fiber,itgt);
         fix_priority(itgt,pri);
         }
       }
   };
 
+void assign_new (ETS_data &d, std::vector<size_t> &tid,
+  std::vector<size_t> &cid)
+  { NewAssigner dummy(d,tid,cid); }
+
+/*! Same strategy as NewAssigner, but with a lazy_heap: the priority updates
+    after an assignment only store the new values, and the targets made
+    unobservable by cleanup() are removed in bulk instead of being moved to
+    the bottom of the queue one by one. Ties between targets of equal
+    priority are resolved by index, so the order of the assignments can
+    differ from that of NewAssigner where their priorities are equal. */
+void assign_new_lazy (ETS_data &d, std::vector<size_t> &tid,
+  std::vector<size_t> &cid)
+  {
+  tid.clear(); cid.clear();
+  if (d.out_of_budget()) return; // don't compute unused priorities
+  const auto &tgt(d.tgt);
+  std::vector<uint8_t> observable(tgt.size());
+  for (size_t i=0; i<tgt.size(); ++i)
+    observable[i]=d.target_count(i)>0;
+  lazy_heap<pq_entry> queue(proximity_priorities(d), observable);
+  d.track_lost_targets();
+  while ((!d.out_of_budget()) && (!queue.empty()))
+    {
+    size_t itgt=queue.pop();
+    size_t fiber=least_used_fiber(d,itgt);
+    tid.push_back(itgt);
+    cid.push_back(fiber);
+    d.cleanup(fiber,itgt);
+    d.for_lost_targets([&](size_t t){ queue.remove(t); });
+    scoped_timer timer(timer_priority);
+    d.rtgt.visit(tgt[itgt].pos,r_kernel,[&](size_t j)
+      {
+      if (!queue.contains(j)) return;
+      pq_entry tpri=queue.priority(j);
+      tpri.prox-=tgt[j].time*tgt[itgt].time
+                *kernelfunc(std::norm(tgt[itgt].pos-tgt[j].pos));
+      queue.lower_priority(j,tpri);
+      });
+    }
+  }
+
+using assigner_func = void (*)(ETS_data &d, std::vector<size_t> &tid,
+  std::vector<size_t> &cid);
+
+/*! Returns the table of all available assignment strategies.
+    New strategies are added by adding an entry here. */
+const std::map<std::string, assigner_func> &assigner_registry()
+  {
+  static const std::map<std::string, assigner_func> registry {
+    /* Naive assignment algorithm: iterate over all fibers, and if a fiber
+       has targets in its patrol area, assign the target with the highest
+       priority to it. */
+    { "naive", assign_greedy<fibers_by_index,
+                             target_maxpri<tiebreak_random>> },
+    /* Assignment strategy modeled after Morales et al. 2012: MNRAS 419, 1187
+       find the fiber(s) with the smallest number of observable targets >0;
+       for the first of the returned fibers, assign the target with highest
+       priority to it; repeat until no more targets are observable. */
+    { "draining", assign_greedy<fibers_draining,
+                                target_maxpri<tiebreak_random>> },
+    /* As "draining", but if there is more than one target with the highest
+       priority, choose the one closest to the center of the patrol area. */
+    { "draining_closest", assign_greedy<fibers_draining,
+                                        target_maxpri<tiebreak_closest>> },
+    { "new", assign_new },
+    /* As "new", with lazily updated priorities; faster for dense fields. */
+    { "new_lazy", assign_new_lazy } };
+  return registry;
+  }
+
+/*! Returns the assignment function registered as \a name. */
+assigner_func find_assigner (const std::string &name)
+  {
+  const auto &registry(assigner_registry());
+  auto it=registry.find(name);
+  planck_assert(it!=registry.end(), "unknown assignment algorithm");
+  return it->second;
+  }
+
+/*! If the last assignment on \a d has been stopped by its budget, removes
+    the limits and assigns the remaining fibers with the "naive" algorithm,
+    appending the results to \a tid and \a cid, and returns \a true. */
+bool complete_naive (ETS_data &d, std::vector<size_t> &tid,
+  std::vector<size_t> &cid)
+  {
+  if (!d.budget_exhausted()) return false;
+  d.clear_budget();
+  std::vector<size_t> tid2, cid2;
+  find_assigner("naive")(d, tid2, cid2);
+  tid.insert(tid.end(),tid2.begin(),tid2.end());
+  cid.insert(cid.end(),cid2.begin(),cid2.end());
+  return true;
+  }
+
+/*! Performs the assignment with the algorithm \a name on \a d, after
+    resetting its state and seeding it with \a seed, within \a budget
+    counted from \a start. Returns \a true if the budget was exhausted. */
+bool run_assigner (const std::string &name, ETS_data &d,
+  std::vector<size_t> &tid, std::vector<size_t> &cid, uint64_t seed,
+  const AssignmentBudget &budget=AssignmentBudget(),
+  std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now())
+  {
+  auto func=find_assigner(name);
+  d.reset(seed);
+  d.set_budget(budget, start);
+  scoped_timer timer(timer_assign);
+  func(d, tid, cid);
+  bool hit=complete_naive(d, tid, cid);
+  add_count(count_assignment, tid.size());
+  return hit;
+  }
+
+/*! Returns the score of the assignment \a tid of the targets \a tgt for the
+    criterion \a score (see getBestObservation()). Scores are compared
+    lexicographically; larger is better. */
+std::vector<double> assignment_score (const std::string &score,
+  const std::vector<Target> &tgt, const std::vector<size_t> &tid)
+  {
+  if (score=="count")
+    return std::vector<double>(1,double(tid.size()));
+  if (score=="time")
+    {
+    double res=0.;
+    for (auto t : tid) res+=tgt[t].time;
+    return std::vector<double>(1,res);
+    }
+  if (score=="priority")
+    {
+    // number of observed targets in every priority class, highest first
+    std::vector<int> pri;
+    for (const auto &t : tgt) pri.push_back(t.pri);
+    std::sort(pri.begin(),pri.end());
+    pri.erase(std::unique(pri.begin(),pri.end()),pri.end());
+    std::vector<double> res(pri.size(),0.);
+    for (auto t : tid)
+      res[std::lower_bound(pri.begin(),pri.end(),tgt[t].pri)-pri.begin()]+=1.;
+    return res;
+    }
+  planck_fail("unknown score");
+  }
+
+/*! Performs \a nstarts assignments with \a algorithm on \a tab, using
+    \a seed for the first one and seeds derived from it for the others, and
+    returns the one with the best \a score (the first one, if there are
+    several). The runs are distributed over \a nthreads threads; they share
+    the tables, and each one only needs its own edge flags and counts. */
+void run_best_of (const ETS_tables &tab, const std::string &algorithm,
+  size_t nstarts, const std::string &score, std::vector<size_t> &tid,
+  std::vector<size_t> &cid, size_t nthreads, uint64_t seed)
+  {
+  planck_assert(nstarts>0, "need at least one start");
+  auto func=find_assigner(algorithm);
+  assignment_score(score, tab.tgt, {}); // fail early for unknown scores
+  struct Run
+    {
+    std::vector<size_t> tid, cid;
+    std::vector<double> score;
+    };
+  std::vector<Run> runs(nstarts);
+  nthreads=get_nthreads(nthreads);
+  size_t nworkers=std::min(nstarts,nthreads);
+  parallel_ranges(nstarts, nworkers, 1, [&](size_t lo, size_t hi)
+    {
+    for (size_t k=lo; k<hi; ++k)
+      {
+      ETS_data d(tab, nthreads/nworkers);
+      d.reset((k==0) ? seed : random_bits(seed,k));
+      // the first start is the plain assignment
+      if (k>0) d.perturb_order();
+      scoped_timer timer(timer_assign);
+      func(d, runs[k].tid, runs[k].cid);
+      add_count(count_assignment, runs[k].tid.size());
+      runs[k].score=assignment_score(score, tab.tgt, runs[k].tid);
+      }
+    });
+  size_t best=0;
+  for (size_t k=1; k<nstarts; ++k)
+    if (runs[best].score<runs[k].score) best=k;
+  tid.swap(runs[best].tid);
+  cid.swap(runs[best].cid);
+  }
+
+/*! Assigns up to \a minobs[c] targets of every class c on \a d, where
+    \a cls holds the class of every target; the classes take turns. Each
+    time, the fiber/target combination whose fiber has the fewest observable
+    targets is chosen (the first one, if there are several), so that
+    as few other targets as possible are lost. The results are appended to
+    \a tid and \a cid. */
+void assign_class_minimum (ETS_data &d, const size_t *cls,
+  const std::vector<size_t> &minobs, std::vector<size_t> &tid,
+  std::vector<size_t> &cid)
+  {
+  std::vector<std::vector<size_t>> members(minobs.size());
+  for (size_t i=0; i<d.tgt.size(); ++i)
+    if (minobs[cls[i]]>0) members[cls[i]].push_back(i);
+  std::vector<size_t> nobs(minobs.size(),0);
+  bool progress=true;
+  while (progress)
+    {
+    progress=false;
+    for (size_t c=0; c<minobs.size(); ++c)
+      {
+      if (nobs[c]>=minobs[c]) continue;
+      size_t itgt=~size_t(0), fiber=0, mincnt=~size_t(0);
+      for (auto t : members[c])
+        d.for_fibers_of(t, [&](size_t f)
+          {
+          if (d.fiber_count(f)<mincnt)
+            { itgt=t; fiber=f; mincnt=d.fiber_count(f); }
+          });
+      if (itgt==~size_t(0)) { nobs[c]=minobs[c]; continue; } // exhausted
+      tid.push_back(itgt);
+      cid.push_back(fiber);
+      d.cleanup(fiber,itgt);
+      ++nobs[c];
+      progress=true;
+      }
+    }
+  }
+
+/*! Disjoint set forest over the indices [0; n[, with path halving and union
+    by size. */
+class union_find
+  {
+  private:
+    std::vector<size_t> parent, size;
+
+  public:
+    union_find (size_t n) : parent(n), size(n,1)
+      { for (size_t i=0; i<n; ++i) parent[i]=i; }
+
+    /*! Returns the representative of the set containing \a i. */
+    size_t find (size_t i)
+      {
+      while (parent[i]!=i)
+        { parent[i]=parent[parent[i]]; i=parent[i]; }
+      return i;
+      }
+    /*! Merges the sets containing \a i and \a j. */
+    void unite (size_t i, size_t j)
+      {
+      i=find(i); j=find(j);
+      if (i==j) return;
+      if (size[i]<size[j]) std::swap(i,j);
+      parent[j]=i;
+      size[i]+=size[j];
+      }
+  };
+
 } // unnamed namespace
 
 std::vector<Cobra> makeCobras()
@@ -634,24 +2176,592 @@ std::vector<Cobra> makeCobras()
   }
 
 std::vector<std::vector<size_t>> getT2F (const std::vector<Target> &targets,
-  const std::vector<Cobra> &cobras)
+  const std::vector<Cobra> &cobras, size_t nthreads)
   {
-  ETS_data tmp(targets,cobras);
+  ETS_cobras cdata(cobras);
+  ETS_tables tab(targets,cdata,nthreads);
+  ETS_data tmp(tab);
   return tmp.T2F();
   }
 
-void getObservation (const std::vector<Target> &targets,
+std::vector<TargetVisibility> getVisMulti (const std::complex<double> *tpos,
+  size_t nvisit, size_t ntgt, const std::vector<Cobra> &cobras,
+  size_t nthreads)
+  {
+  std::vector<TargetVisibility> res(nvisit);
+  for (auto &r : res) r.ofs.assign(ntgt+1,0);
+  if (cobras.empty() || (ntgt==0)) return res;
+
+  double rmax=max_patrol_radius(cobras);
+  fpraster rcbr=cbr2raster(cobras,rmax);
+  scoped_timer timer(timer_mappings);
+  // work on chunks of targets; every chunk produces a partial result whose
+  // offsets are relative to the start of the chunk
+  constexpr size_t chunk=4096;
+  size_t nchunk=(ntgt+chunk-1)/chunk;
+  std::vector<TargetVisibility> part(nvisit*nchunk);
+  parallel_ranges(nvisit*nchunk, nthreads, 1, [&](size_t lo, size_t hi)
+    {
+    std::vector<size_t> cand;
+    for (size_t item=lo; item<hi; ++item)
+      {
+      size_t ivis=item/nchunk, t0=(item%nchunk)*chunk,
+             t1=std::min(ntgt,t0+chunk);
+      auto &out(part[item]);
+      out.ofs.reserve(t1-t0+1);
+      out.ofs.push_back(0);
+      for (size_t t=t0; t<t1; ++t)
+        {
+        vec2 pos(tpos[ivis*ntgt+t]);
+        cand.clear();
+        rcbr.visit(pos,rmax,[&](size_t c)
+          { if (cobra_reaches(cobras[c],pos)) cand.push_back(c); });
+        std::sort(cand.begin(),cand.end());
+        for (auto c : cand)
+          {
+          out.cobra.push_back(c);
+          out.elbow.push_back(elbow_pos(cobras[c],pos));
+          }
+        out.ofs.push_back(out.cobra.size());
+        }
+      }
+    });
+  parallel_ranges(nvisit, nthreads, 1, [&](size_t lo, size_t hi)
+    {
+    for (size_t ivis=lo; ivis<hi; ++ivis)
+      {
+      auto &r(res[ivis]);
+      size_t nedge=0;
+      for (size_t ic=0; ic<nchunk; ++ic)
+        nedge+=part[ivis*nchunk+ic].cobra.size();
+      r.cobra.reserve(nedge);
+      r.elbow.reserve(nedge);
+      for (size_t ic=0; ic<nchunk; ++ic)
+        {
+        auto &p(part[ivis*nchunk+ic]);
+        size_t base=r.cobra.size(), t0=ic*chunk;
+        for (size_t k=1; k<p.ofs.size(); ++k)
+          r.ofs[t0+k]=base+p.ofs[k];
+        r.cobra.insert(r.cobra.end(),p.cobra.begin(),p.cobra.end());
+        r.elbow.insert(r.elbow.end(),p.elbow.begin(),p.elbow.end());
+        p=TargetVisibility(); // release memory early
+        }
+      }
+    });
+  return res;
+  }
+
+void getCollidingPairs (const std::complex<double> *tpos, const size_t *ofs,
+  size_t ntgt, double dist, std::vector<size_t> &pi, std::vector<size_t> &pj,
+  size_t nthreads)
+  {
+  pi.clear(); pj.clear();
+  std::vector<size_t> vidx;
+  std::vector<vec2> vpos;
+  for (size_t i=0; i<ntgt; ++i)
+    if (ofs[i+1]>ofs[i])
+      { vidx.push_back(i); vpos.push_back(tpos[i]); }
+  if (vidx.empty()) return;
+  fpraster raster(vpos,dist);
+  // every pair is only reported by its member with the lower index
+  constexpr size_t chunk=1024;
+  size_t nchunk=(vidx.size()+chunk-1)/chunk;
+  std::vector<std::vector<size_t>> ri(nchunk), rj(nchunk);
+  parallel_ranges(vidx.size(), nthreads, chunk, [&](size_t lo, size_t hi)
+    {
+    auto &li(ri[lo/chunk]), &lj(rj[lo/chunk]);
+    std::vector<size_t> ngb;
+    for (size_t m=lo; m<hi; ++m)
+      {
+      ngb.clear();
+      raster.visit(vpos[m],dist,[&](size_t n)
+        {
+        if ((n>m)&&(std::norm(vpos[m]-vpos[n])<dist*dist))
+          ngb.push_back(vidx[n]);
+        });
+      std::sort(ngb.begin(),ngb.end());
+      for (auto n : ngb)
+        { li.push_back(vidx[m]); lj.push_back(n); }
+      }
+    });
+  for (size_t c=0; c<nchunk; ++c)
+    {
+    pi.insert(pi.end(),ri[c].begin(),ri[c].end());
+    pj.insert(pj.end(),rj[c].begin(),rj[c].end());
+    }
+  }
+
+void getElbowCollisions (const std::complex<double> *tpos, size_t ntgt,
+  const size_t *vofs, const size_t *vcobra, const std::complex<double> *velbow,
+  double dist, std::vector<size_t> &ofs, std::vector<size_t> &blocked,
+  size_t nthreads)
+  {
+  size_t nedge=vofs[ntgt];
+  ofs.assign(nedge+1,0);
+  blocked.clear();
+  std::vector<size_t> vidx;
+  std::vector<vec2> vpos;
+  for (size_t i=0; i<ntgt; ++i)
+    if (vofs[i+1]>vofs[i])
+      { vidx.push_back(i); vpos.push_back(tpos[i]); }
+  if (vidx.empty()) return;
+  fpraster raster(vpos,dist);
+  // work on chunks of targets; every chunk collects the results for the
+  // combinations belonging to its targets
+  constexpr size_t chunk=256;
+  size_t nchunk=(vidx.size()+chunk-1)/chunk;
+  std::vector<std::vector<size_t>> part(nchunk);
+  parallel_ranges(vidx.size(), nthreads, chunk, [&](size_t lo, size_t hi)
+    {
+    auto &out(part[lo/chunk]);
+    std::vector<size_t> tmp, cand;
+    std::vector<double> cx, cy;
+    std::vector<uint8_t> coll;
+    for (size_t m=lo; m<hi; ++m)
+      {
+      size_t t=vidx[m];
+      vec2 tip(tpos[t]);
+      for (size_t k=vofs[t]; k<vofs[t+1]; ++k)
+        {
+        vec2 elbow(velbow[k]);
+        cand.clear(); cx.clear(); cy.clear();
+        raster.visit(0.5*(tip+elbow), dist+0.5*abs(tip-elbow), [&](size_t n)
+          {
+          size_t t2=vidx[n];
+          // t2 must be observable by some cobra other than vcobra[k]
+          if ((vofs[t2+1]-vofs[t2]==1) && (vcobra[vofs[t2]]==vcobra[k]))
+            return;
+          cand.push_back(t2);
+          cx.push_back(vpos[n].x());
+          cy.push_back(vpos[n].y());
+          });
+        coll.resize(cand.size());
+        line_segment_collision_batch(elbow, tip, cx.data(), cy.data(),
+          cand.size(), dist, coll.data());
+        tmp.clear();
+        for (size_t n=0; n<cand.size(); ++n)
+          if (coll[n]) tmp.push_back(cand[n]);
+        std::sort(tmp.begin(),tmp.end());
+        ofs[k+1]=tmp.size();
+        out.insert(out.end(),tmp.begin(),tmp.end());
+        }
+      }
+    });
+  for (size_t k=0; k<nedge; ++k)
+    ofs[k+1]+=ofs[k];
+  blocked.reserve(ofs[nedge]);
+  for (const auto &p : part)
+    blocked.insert(blocked.end(),p.begin(),p.end());
+  }
+
+size_t getTargetComponents (size_t ntgt, const size_t *etgt,
+  const size_t *egroup, size_t nedge, const size_t *pi, const size_t *pj,
+  size_t npair, std::vector<size_t> &label)
+  {
+  constexpr size_t none=~size_t(0);
+  union_find uf(ntgt);
+  std::vector<uint8_t> used(ntgt,0);
+  // the group numbers may be arbitrary; work with their ranks instead
+  std::vector<size_t> gnum(egroup,egroup+nedge);
+  std::sort(gnum.begin(),gnum.end());
+  gnum.erase(std::unique(gnum.begin(),gnum.end()),gnum.end());
+  std::vector<size_t> gfirst(gnum.size(),none); // first target of each group
+  for (size_t k=0; k<nedge; ++k)
+    {
+    size_t t=etgt[k],
+      g=std::lower_bound(gnum.begin(),gnum.end(),egroup[k])-gnum.begin();
+    planck_assert(t<ntgt, "bad target index");
+    used[t]=1;
+    if (gfirst[g]==none)
+      gfirst[g]=t;
+    else
+      uf.unite(gfirst[g],t);
+    }
+  for (size_t k=0; k<npair; ++k)
+    {
+    planck_assert((pi[k]<ntgt)&&(pj[k]<ntgt), "bad target index");
+    if (used[pi[k]] && used[pj[k]]) uf.unite(pi[k],pj[k]);
+    }
+  label.assign(ntgt,none);
+  std::vector<size_t> rootlabel(ntgt,none);
+  size_t ncomp=0;
+  for (size_t i=0; i<ntgt; ++i)
+    {
+    if (!used[i]) continue;
+    size_t r=uf.find(i);
+    if (rootlabel[r]==none) rootlabel[r]=ncomp++;
+    label[i]=rootlabel[r];
+    }
+  return ncomp;
+  }
+
+bool getObservation (const std::vector<Target> &targets,
   const std::vector<Cobra> &cobras, const std::string &algorithm,
-  std::vector<size_t> &tid, std::vector<size_t> &cid)
-  {
-  if (algorithm=="naive")
-    NaiveAssigner dummy(targets,cobras,tid,cid);
-  else if (algorithm=="draining")
-    DrainingAssigner dummy(targets,cobras,tid,cid);
-  else if (algorithm=="draining_closest")
-    DrainingClosestAssigner dummy(targets,cobras,tid,cid);
-  else if (algorithm=="new")
-    NewAssigner dummy(targets,cobras,tid,cid);
+  std::vector<size_t> &tid, std::vector<size_t> &cid, size_t nthreads,
+  uint64_t seed, const AssignmentBudget &budget)
+  {
+  auto start=std::chrono::steady_clock::now();
+  ETS_cobras cdata(cobras);
+  ETS_tables tab(targets,cdata,nthreads);
+  ETS_data data(tab);
+  return run_assigner(algorithm,data,tid,cid,seed,budget,start);
+  }
+
+void getObservations (const std::vector<Target> &targets,
+  const std::vector<Cobra> &cobras, const std::vector<std::string> &algorithms,
+  std::vector<std::vector<size_t>> &tid, std::vector<std::vector<size_t>> &cid,
+  size_t nthreads, uint64_t seed)
+  {
+  tid.resize(algorithms.size());
+  cid.resize(algorithms.size());
+  ETS_cobras cdata(cobras);
+  ETS_tables tab(targets,cdata,nthreads);
+  ETS_data data(tab);
+  for (size_t i=0; i<algorithms.size(); ++i)
+    run_assigner(algorithms[i],data,tid[i],cid[i],seed);
+  }
+
+void getBestObservation (const std::vector<Target> &targets,
+  const std::vector<Cobra> &cobras, const std::string &algorithm,
+  size_t nstarts, const std::string &score, std::vector<size_t> &tid,
+  std::vector<size_t> &cid, size_t nthreads, uint64_t seed)
+  {
+  ETS_cobras cdata(cobras);
+  ETS_tables tab(targets,cdata,nthreads);
+  run_best_of(tab,algorithm,nstarts,score,tid,cid,nthreads,seed);
+  }
+
+void getMultiVisitObservation (const std::complex<double> *tpos,
+  size_t nvisit, size_t ntgt, const double *time, const int *pri,
+  const size_t *cls, const std::vector<uint8_t> &calib,
+  const std::vector<size_t> &minobs, const std::vector<Cobra> &cobras,
+  const std::string &algorithm, double tvisit,
+  std::vector<std::vector<size_t>> &tid, std::vector<std::vector<size_t>> &cid,
+  std::vector<double> &remaining, size_t nthreads, uint64_t seed)
+  {
+  auto func=find_assigner(algorithm);
+  planck_assert(tvisit>0, "visit duration must be positive");
+  planck_assert(calib.size()==minobs.size(), "class table size mismatch");
+  std::vector<size_t> calmin(minobs.size(),0), nreq(ntgt,0);
+  for (size_t c=0; c<calib.size(); ++c)
+    if (calib[c]) calmin[c]=minobs[c];
+  for (size_t i=0; i<ntgt; ++i)
+    {
+    planck_assert(cls[i]<calib.size(), "bad target class");
+    // allow for rounding errors in times that are multiples of tvisit
+    if (!calib[cls[i]]) nreq[i]=size_t(time[i]/tvisit*(1.+1e-12));
+    }
+  std::vector<size_t> nleft(nreq);
+  tid.assign(nvisit,std::vector<size_t>());
+  cid.assign(nvisit,std::vector<size_t>());
+  if (ntgt>0)
+    {
+    ETS_cobras cdata(cobras);
+    std::vector<Target> tgt;
+    std::unique_ptr<ETS_tables> tab;
+    for (size_t v=0; v<nvisit; ++v)
+      {
+      const std::complex<double> *pos=tpos+v*ntgt;
+      bool same_pos=bool(tab);
+      for (size_t i=0; same_pos && (i<ntgt); ++i)
+        same_pos = (vec2(pos[i])==tgt[i].pos);
+      if (!same_pos)
+        {
+        tab.reset(); // refers to tgt
+        tgt.clear();
+        for (size_t i=0; i<ntgt; ++i)
+          tgt.emplace_back(pos[i],0.,pri[i]);
+        tab.reset(new ETS_tables(tgt,cdata,nthreads));
+        }
+      // the assigners see the total time of every target, so that started
+      // targets keep their weight and tend to be completed
+      for (size_t i=0; i<ntgt; ++i)
+        {
+        tgt[i].time=calib[cls[i]] ? tvisit : nreq[i]*tvisit;
+        if ((!calib[cls[i]]) && (nleft[i]==0)) tab->deactivate_target(i);
+        }
+      ETS_data d(*tab);
+      d.reset(seed+v);
+      {
+      scoped_timer timer(timer_assign);
+      assign_class_minimum(d, cls, calmin, tid[v], cid[v]);
+      std::vector<size_t> tid2, cid2;
+      func(d, tid2, cid2);
+      tid[v].insert(tid[v].end(),tid2.begin(),tid2.end());
+      cid[v].insert(cid[v].end(),cid2.begin(),cid2.end());
+      add_count(count_assignment, tid[v].size());
+      }
+      for (auto t : tid[v])
+        if (!calib[cls[t]]) --nleft[t];
+      }
+    }
+  remaining.assign(ntgt,0.);
+  for (size_t i=0; i<ntgt; ++i)
+    if (!calib[cls[i]])
+      remaining[i]=std::max(0.,time[i]-(nreq[i]-nleft[i])*tvisit);
+  }
+
+std::vector<std::string> getAssigners()
+  {
+  std::vector<std::string> res;
+  for (const auto &entry : assigner_registry())
+    res.push_back(entry.first);
+  return res;
+  }
+
+struct ETSStats::Impl
+  {
+  stats_sink sink;
+  stats_binding binding;
+
+  Impl() : binding(&sink) {}
+  };
+
+ETSStats::ETSStats() : impl(new Impl) {}
+ETSStats::~ETSStats() = default;
+
+bool ETSStats::enabled()
+  {
+#ifdef ETS_STATS
+  return true;
+#else
+  return false;
+#endif
+  }
+
+std::map<std::string, double> ETSStats::values() const
+  {
+  std::map<std::string, double> res;
+#ifdef ETS_STATS
+  if (stats_tls.sink==&impl->sink) stats_tls.flush();
+#endif
+  std::lock_guard<std::mutex> lock(impl->sink.mtx);
+  for (size_t i=0; i<n_counters; ++i)
+    res[counter_name[i]]=double(impl->sink.count[i]);
+  for (size_t i=0; i<n_timers; ++i)
+    res[timer_name[i]]=1e-9*impl->sink.nsec[i];
+  return res;
+  }
+
+struct ETSContext::Impl
+  {
+  struct Result
+    {
+    std::vector<size_t> tid, cid;
+    size_t nchanges; // value of \a nchanges when computed
+    };
+
+  ETS_cobras cobras;
+  size_t nthreads;
+  std::vector<Target> tgt;
+  std::unique_ptr<ETS_tables> tab;
+  std::unique_ptr<ETS_data> data;
+  // number of target changes since setTargets(), and for every target the
+  // value of this counter after its last change (0: unchanged)
+  size_t nchanges=0;
+  std::vector<size_t> changed;
+  // the most recent result of every algorithm
+  std::map<std::string, Result> last;
+
+  Impl (const std::vector<Cobra> &cbr, size_t nthreads_)
+    : cobras(cbr), nthreads(nthreads_) {}
+
+  /*! Records a change of the target \a i. */
+  void mark_changed (size_t i)
+    { changed[i]=++nchanges; }
+
+  /*! Builds the tables for all targets from scratch. */
+  void rebuild()
+    {
+    data.reset();
+    std::vector<uint8_t> active;
+    if (tab) active.swap(tab->active);
+    tab.reset();
+    if (tgt.empty()) return;
+    tab.reset(new ETS_tables(tgt, cobras, nthreads));
+    for (size_t i=0; i<active.size(); ++i)
+      if (!active[i]) tab->deactivate_target(i);
+    data.reset(new ETS_data(*tab));
+    }
+
+  /*! Returns flags for all fibers which could observe, or collide with a
+      fiber observing, any of the targets changed after the change counter
+      had the value \a since. */
+  std::vector<uint8_t> affected_fibers (size_t since) const
+    {
+    std::vector<uint8_t> res(cobras.cbr.size(),0);
+    double rad=2*cobras.rmax+tab->colldist;
+    for (size_t i=0; i<tgt.size(); ++i)
+      if (changed[i]>since)
+        cobras.rcbr.visit(tgt[i].pos, rad, [&](size_t c){ res[c]=1; });
+    return res;
+    }
+
+  bool run (const std::string &algorithm, std::vector<size_t> &tid,
+    std::vector<size_t> &cid, double maxdelta, uint64_t seed,
+    const AssignmentBudget &budget=AssignmentBudget())
+    {
+    auto start=std::chrono::steady_clock::now();
+    auto func=find_assigner(algorithm);
+    tid.clear(); cid.clear();
+    bool hit=false;
+    if (data)
+      {
+      scoped_timer timer(timer_assign);
+      data->reset(seed);
+      auto it=last.find(algorithm);
+      if ((maxdelta>0) && (it!=last.end()))
+        {
+        auto affected=affected_fibers(it->second.nchanges);
+        size_t naff=std::count(affected.begin(),affected.end(),1);
+        if (naff<=maxdelta*affected.size())
+          {
+          // keep the previous assignments of all unaffected fibers
+          const auto &prev(it->second);
+          for (size_t i=0; i<prev.tid.size(); ++i)
+            {
+            size_t t=prev.tid[i], f=prev.cid[i];
+            if (affected[f] || !data->can_observe(f,t)) continue;
+            tid.push_back(t);
+            cid.push_back(f);
+            data->cleanup(f,t);
+            }
+          }
+        }
+      // assign the remaining fibers
+      std::vector<size_t> tid2, cid2;
+      data->set_budget(budget, start);
+      func(*data, tid2, cid2);
+      hit=complete_naive(*data, tid2, cid2);
+      tid.insert(tid.end(),tid2.begin(),tid2.end());
+      cid.insert(cid.end(),cid2.begin(),cid2.end());
+      add_count(count_assignment, tid.size());
+      }
+    last[algorithm] = Result{tid, cid, nchanges};
+    return hit;
+    }
+  };
+
+ETSContext::ETSContext (const std::vector<Cobra> &cobras, size_t nthreads)
+  : impl(new Impl(cobras, nthreads)) {}
+ETSContext::ETSContext (ETSContext &&other) = default;
+ETSContext &ETSContext::operator= (ETSContext &&other) = default;
+ETSContext::~ETSContext() = default;
+
+const std::vector<Cobra> &ETSContext::cobras() const
+  { return impl->cobras.cbr; }
+
+void ETSContext::setTargets (const std::vector<Target> &targets)
+  {
+  auto &d(*impl);
+  bool same_pos = (targets.size()==d.tgt.size())
+               && (d.tab || targets.empty())
+               && ((!d.tab) || (std::find(d.tab->active.begin(),
+                                  d.tab->active.end(),0)==d.tab->active.end()));
+  for (size_t i=0; same_pos && (i<targets.size()); ++i)
+    same_pos = (targets[i].pos==d.tgt[i].pos);
+  if (same_pos) // the mappings depend only on the target positions
+    {
+    for (size_t i=0; i<targets.size(); ++i)
+      if ((targets[i].time!=d.tgt[i].time) || (targets[i].pri!=d.tgt[i].pri))
+        d.mark_changed(i);
+    d.tgt=targets;
+    if (d.tab) d.tab->rtgt.rebind(target_positions(d.tgt));
+    return;
+    }
+  d.tab.reset();
+  d.tgt=targets;
+  d.nchanges=0;
+  d.changed.assign(d.tgt.size(),0);
+  d.last.clear();
+  d.rebuild();
+  }
+
+void ETSContext::updateTargets (const std::vector<double> &time,
+  const std::vector<int> &pri)
+  {
+  auto &d(*impl);
+  planck_assert((time.size()==d.tgt.size())&&(pri.size()==d.tgt.size()),
+    "vector length mismatch");
+  for (size_t i=0; i<d.tgt.size(); ++i)
+    if ((time[i]!=d.tgt[i].time) || (pri[i]!=d.tgt[i].pri))
+      {
+      d.tgt[i].time=time[i];
+      d.tgt[i].pri=pri[i];
+      d.mark_changed(i);
+      }
+  }
+
+void ETSContext::removeTargets (const std::vector<size_t> &idx)
+  {
+  auto &d(*impl);
+  for (auto i : idx)
+    {
+    planck_assert(i<d.tgt.size(), "bad target index");
+    if (!d.tab->active[i]) continue;
+    d.tab->deactivate_target(i);
+    d.mark_changed(i);
+    }
+  }
+
+void ETSContext::addTargets (const std::vector<Target> &targets)
+  {
+  auto &d(*impl);
+  if (targets.empty()) return;
+  size_t first=d.tgt.size();
+  d.tgt.insert(d.tgt.end(),targets.begin(),targets.end());
+  d.changed.resize(d.tgt.size(),0);
+  for (size_t i=first; i<d.tgt.size(); ++i)
+    d.mark_changed(i);
+  // Added targets are not sorted into the raster bins, which slows down
+  // every query; rebuild everything once there are too many of them.
+  if (d.tab && (d.tab->rtgt.ntail()+targets.size()<=first/8))
+    {
+    d.tab->add_targets(first);
+    d.data->reset();
+    }
   else
-    planck_fail("unknown assignment algorithm");
+    d.rebuild();
+  }
+
+std::vector<std::vector<size_t>> ETSContext::T2F()
+  {
+  if (!impl->data) return std::vector<std::vector<size_t>>(impl->tgt.size());
+  impl->data->reset();
+  return impl->data->T2F();
   }
+
+bool ETSContext::getObservation (const std::string &algorithm,
+  std::vector<size_t> &tid, std::vector<size_t> &cid, uint64_t seed,
+  const AssignmentBudget &budget)
+  { return impl->run(algorithm, tid, cid, 0., seed, budget); }
+
+void ETSContext::getObservations (const std::vector<std::string> &algorithms,
+  std::vector<std::vector<size_t>> &tid, std::vector<std::vector<size_t>> &cid,
+  uint64_t seed)
+  {
+  tid.resize(algorithms.size());
+  cid.resize(algorithms.size());
+  for (size_t i=0; i<algorithms.size(); ++i)
+    getObservation(algorithms[i], tid[i], cid[i], seed);
+  }
+
+void ETSContext::getBestObservation (const std::string &algorithm,
+  size_t nstarts, const std::string &score, std::vector<size_t> &tid,
+  std::vector<size_t> &cid, uint64_t seed)
+  {
+  auto &d(*impl);
+  tid.clear(); cid.clear();
+  if (!d.tab)
+    {
+    find_assigner(algorithm);
+    assignment_score(score, d.tgt, {});
+    return;
+    }
+  run_best_of(*d.tab,algorithm,nstarts,score,tid,cid,d.nthreads,seed);
+  }
+
+void ETSContext::getObservationIncremental (const std::string &algorithm,
+  std::vector<size_t> &tid, std::vector<size_t> &cid, double maxdelta,
+  uint64_t seed)
+  { impl->run(algorithm, tid, cid, maxdelta, seed); }
@@ -25,9 +25,12 @@
 #define ETS_H
 
 #include <complex>
+#include <cstdint>
 #include <vector>
 #include <algorithm>
 #include <string>
+#include <memory>
+#include <map>
 
 /*! Simple class for storing a position in a 2D plane. */
 class vec2: public std::complex<double>
@@ -66,12 +69,262 @@ class Cobra
       : center(center_), l1(l1_), l2(l2_), dotpos(dotpos_), rdot(rdot_) {}
   };
 
+/*! Limits for an assignment (see getObservation()); 0 means no limit.
+    \a seconds is the wall clock time since the start of the call, including
+    the computation of the fiber/target mappings, and \a iterations the
+    number of targets assigned by the algorithm. */
+class AssignmentBudget
+  {
+  public:
+    double seconds;
+    size_t iterations;
+
+    AssignmentBudget (double seconds_=0., size_t iterations_=0)
+      : seconds(seconds_), iterations(iterations_) {}
+  };
 
+
+/*! Visibility information for a set of targets in compressed form: the
+    cobras able to observe target \a i are stored in ascending order at the
+    indices [ofs[i]; ofs[i+1][ of \a cobra, and \a elbow holds the
+    corresponding elbow positions. */
+class TargetVisibility
+  {
+  public:
+    std::vector<size_t> ofs, cobra;
+    std::vector<vec2> elbow;
+  };
+
+/*! Returns, for every target in \a targets, the indices of all cobras that
+    can observe it. The computation uses \a nthreads threads (0 means one per
+    hardware thread). */
 std::vector<std::vector<size_t>> getT2F (const std::vector<Target> &targets,
-  const std::vector<Cobra> &cobras);
+  const std::vector<Cobra> &cobras, size_t nthreads=1);
+
+/*! Computes the visibility information for \a nvisit visits of the same
+    \a ntgt targets. \a tpos contains the target positions of all visits
+    (visit-major, i.e. position \a j of visit \a i is found at
+    tpos[i*ntgt+j]). The cobra raster is set up only once for all visits.
+    The computation uses \a nthreads threads (0 means one per hardware
+    thread). */
+std::vector<TargetVisibility> getVisMulti (const std::complex<double> *tpos,
+  size_t nvisit, size_t ntgt, const std::vector<Cobra> &cobras,
+  size_t nthreads=1);
+
+/*! Determines all pairs of visible targets that are closer to each other
+    than \a dist. \a tpos holds the \a ntgt target positions, and target
+    \a i is considered visible if ofs[i+1]>ofs[i] (i.e. \a ofs are the
+    offsets of a TargetVisibility table for these targets).
+    On return, \a pi and \a pj contain the pairs, with pi[k]<pj[k]; they are
+    sorted lexicographically. The computation uses \a nthreads threads
+    (0 means one per hardware thread). */
+void getCollidingPairs (const std::complex<double> *tpos, const size_t *ofs,
+  size_t ntgt, double dist, std::vector<size_t> &pi, std::vector<size_t> &pj,
+  size_t nthreads=1);
+
+/*! Determines, for every (target, cobra) combination of a visibility table,
+    the targets that lie closer than \a dist to the cobra's upper arm (i.e.
+    the line segment between the elbow and the target), and which can be
+    observed by at least one other cobra.
+    \a tpos holds the \a ntgt target positions; \a vofs, \a vcobra and
+    \a velbow are the arrays of a TargetVisibility table for these targets.
+    On return, the targets blocked by the combination stored at index \a k
+    of the visibility table are found at the indices [ofs[k]; ofs[k+1][ of
+    \a blocked, in ascending order. The computation uses \a nthreads
+    threads (0 means one per hardware thread). */
+void getElbowCollisions (const std::complex<double> *tpos, size_t ntgt,
+  const size_t *vofs, const size_t *vcobra, const std::complex<double> *velbow,
+  double dist, std::vector<size_t> &ofs, std::vector<size_t> &blocked,
+  size_t nthreads=1);
+
+/*! Splits \a ntgt targets into groups that can be assigned independently of
+    each other. The \a nedge entries of \a etgt and \a egroup describe the
+    possible observations: target etgt[k] can be observed by the cobra (and
+    visit) with the number egroup[k], e.g. ivisit*ncobra+icobra; the numbers
+    need not be dense. Targets sharing a group are joined, and so are the
+    targets pi[k] and pj[k] of each of the \a npair conflicting pairs (e.g.
+    from getCollidingPairs() or getElbowCollisions()).
+    On return, \a label holds the component number of every target, or
+    ~size_t(0) for targets without possible observations. The components are
+    numbered in order of their smallest target index; their number is
+    returned. */
+size_t getTargetComponents (size_t ntgt, const size_t *etgt,
+  const size_t *egroup, size_t nedge, const size_t *pi, const size_t *pj,
+  size_t npair, std::vector<size_t> &label);
+
+/*! Assigns the \a targets to the \a cobras with the given \a algorithm (see
+    getAssigners()); target tid[i] is observed by cobra cid[i].
+    The visibility computation uses \a nthreads threads (0 means one per
+    hardware thread). Ties between targets of equal priority are broken
+    randomly where the algorithm requires it; the result depends only on
+    \a seed and the input, not on the number of threads or earlier calls.
+    If a limit of \a budget is reached, the algorithm is stopped, its
+    assignments so far are kept, and the remaining fibers are assigned by
+    the fast "naive" algorithm; in this case \a true is returned. With a
+    time limit, the result depends on the speed of the machine. */
+bool getObservation (const std::vector<Target> &targets,
+  const std::vector<Cobra> &cobras, const std::string &algorithm,
+  std::vector<size_t> &tid, std::vector<size_t> &cid, size_t nthreads=1,
+  uint64_t seed=42, const AssignmentBudget &budget=AssignmentBudget());
 
-void getObservation (const std::vector<Target> &targets,
+/*! Performs the assignment with each of the given \a algorithms for the same
+    targets and cobras; the fiber/target mappings are computed only once.
+    The results of algorithms[i] are stored in tid[i] and cid[i]. */
+void getObservations (const std::vector<Target> &targets,
+  const std::vector<Cobra> &cobras, const std::vector<std::string> &algorithms,
+  std::vector<std::vector<size_t>> &tid, std::vector<std::vector<size_t>> &cid,
+  size_t nthreads=1, uint64_t seed=42);
+
+/*! Performs \a nstarts assignments with \a algorithm, using \a seed for the
+    first one and different seeds derived from it for the others, and
+    returns the best one according to \a score:
+    - "count": the number of observed targets,
+    - "time": the total observation time of the observed targets,
+    - "priority": the number of observed targets of the highest priority,
+      then of the next one, and so on.
+    Of several equally good results, that of the earliest start is returned.
+    The first start gives the same result as getObservation(). The other
+    starts also process fibers with equally many observable targets in a
+    random order, and break near-ties (within 1%) of the criteria of the
+    deterministic algorithms ("draining_closest", "new", "new_lazy")
+    randomly, so that every algorithm explores different assignments. The
+    fiber/target mappings are computed once and shared by all starts, which
+    run in parallel on \a nthreads threads (0 means one per hardware
+    thread); the result does not depend on the number of threads. */
+void getBestObservation (const std::vector<Target> &targets,
   const std::vector<Cobra> &cobras, const std::string &algorithm,
-  std::vector<size_t> &tid, std::vector<size_t> &cid);
+  size_t nstarts, const std::string &score, std::vector<size_t> &tid,
+  std::vector<size_t> &cid, size_t nthreads=1, uint64_t seed=42);
+
+/*! Greedy plan for \a nvisit visits of duration \a tvisit, following the
+    network flow model of netflow.buildProblem(), for quick-look planning or
+    as a fallback for the ILP solver. \a tpos holds the positions of the
+    \a ntgt targets for every visit (visit-major), \a cls the class of every
+    target. Targets of classes c with calib[c]!=0 are calibration targets,
+    which can be observed in every visit; at the start of every visit, up to
+    minobs[c] of them are assigned, to fibers with as few alternatives as
+    possible. All other targets are science targets; target i needs
+    \a time[i]/tvisit visits (rounded down) and is not offered any more once
+    it has got them. The remaining fibers of every visit are assigned with
+    \a algorithm, using the priorities \a pri and seed+v as the seed of visit
+    v. On return, tid[v] and cid[v] hold the assignment of visit v, and
+    \a remaining the observation time still missing for every target (zero
+    for calibration targets). Consecutive visits with identical target
+    positions share their fiber/target mappings. */
+void getMultiVisitObservation (const std::complex<double> *tpos,
+  size_t nvisit, size_t ntgt, const double *time, const int *pri,
+  const size_t *cls, const std::vector<uint8_t> &calib,
+  const std::vector<size_t> &minobs, const std::vector<Cobra> &cobras,
+  const std::string &algorithm, double tvisit,
+  std::vector<std::vector<size_t>> &tid, std::vector<std::vector<size_t>> &cid,
+  std::vector<double> &remaining, size_t nthreads=1, uint64_t seed=42);
+
+/*! Returns the names of all available assignment algorithms. */
+std::vector<std::string> getAssigners();
+
+/*! Timings and event counts of the computations in this library, for
+    tuning. If the library is compiled with ETS_STATS defined, everything
+    computed by the calling thread (and the worker threads it starts) during
+    the lifetime of an ETSStats object is recorded in it; if several objects
+    are alive, the most recently created one receives the numbers. Otherwise,
+    all values stay zero. Objects must be destroyed in the thread that
+    created them, in reverse order of creation. */
+class ETSStats
+  {
+  private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+
+  public:
+    ETSStats();
+    ~ETSStats();
+
+    /*! Returns \a true if the library collects statistics. */
+    static bool enabled();
+    /*! Returns the counters
+        - "queries": spatial index queries,
+        - "candidates": entries tested by these queries,
+        - "edges_removed": fiber/target combinations excluded during the
+          assignments,
+        - "pqueue_sifts": priority queue updates,
+        - "assignments": targets assigned,
+        and the times (in seconds) spent in the phases
+        - "time_raster": setting up the spatial indices,
+        - "time_mappings": computing the fiber/target combinations,
+        - "time_inversion": sorting them by target,
+        - "time_cleanup": excluding combinations after an assignment,
+        - "time_priority": computing and updating target priorities,
+        - "time_assign": the assignments, including the two phases above.
+        Times of several threads are added up. */
+    std::map<std::string, double> values() const;
+  };
+
+/*! Persistent setup for repeated assignments on the same focal plane.
+    The cobra geometry and the cobra raster are computed only once; the
+    targets of every visit are passed via setTargets(). If only their
+    observation times or priorities differ from the previous call, the
+    fiber/target mappings are kept as well. Small changes of the target list
+    can be applied with removeTargets() and addTargets() and followed by an
+    incremental assignment. */
+class ETSContext
+  {
+  private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+
+  public:
+    /*! Prepares assignments for \a cobras. All computations use \a nthreads
+        threads (0 means one per hardware thread). */
+    explicit ETSContext (const std::vector<Cobra> &cobras, size_t nthreads=1);
+    ETSContext (ETSContext &&other);
+    ETSContext &operator= (ETSContext &&other);
+    ~ETSContext();
+
+    const std::vector<Cobra> &cobras() const;
+    /*! Sets the targets used by the following calls. Targets removed by
+        removeTargets() become available again, which requires a rebuild of
+        the mappings; use updateTargets() to keep them removed. */
+    void setTargets (const std::vector<Target> &targets);
+    /*! Changes the observation times and priorities of the current targets
+        (e.g. the reduced times after a visit), without touching the
+        mappings; removed targets stay removed. */
+    void updateTargets (const std::vector<double> &time,
+      const std::vector<int> &pri);
+    /*! Removes the targets with the indices \a idx (e.g. because their
+        observation has been completed). The indices of the remaining
+        targets are not changed. */
+    void removeTargets (const std::vector<size_t> &idx);
+    /*! Appends \a targets to the target list. Only the fiber/target
+        combinations of the new targets are computed. */
+    void addTargets (const std::vector<Target> &targets);
+    /*! Returns, for every target, the fibers able to observe it. */
+    std::vector<std::vector<size_t>> T2F();
+    /*! Performs the assignment for the current targets with \a algorithm;
+        see getObservation(). The time limit of \a budget counts from the
+        start of this call. */
+    bool getObservation (const std::string &algorithm,
+      std::vector<size_t> &tid, std::vector<size_t> &cid, uint64_t seed=42,
+      const AssignmentBudget &budget=AssignmentBudget());
+    /*! Performs the assignment for the current targets with each of the
+        given \a algorithms; see getObservations(). */
+    void getObservations (const std::vector<std::string> &algorithms,
+      std::vector<std::vector<size_t>> &tid,
+      std::vector<std::vector<size_t>> &cid, uint64_t seed=42);
+    /*! Performs the best of \a nstarts assignments for the current
+        targets; see getBestObservation(). */
+    void getBestObservation (const std::string &algorithm, size_t nstarts,
+      const std::string &score, std::vector<size_t> &tid,
+      std::vector<size_t> &cid, uint64_t seed=42);
+    /*! Like getObservation(), but starts from the previous result of
+        \a algorithm: the assignments of all fibers not affected by the target
+        changes since then (via setTargets() with unchanged positions,
+        updateTargets(), removeTargets() and addTargets()) are kept, and only
+        the remaining fibers are assigned again. If more than a fraction
+        \a maxdelta of all fibers is affected, or if there is no previous
+        result, a full assignment is done. */
+    void getObservationIncremental (const std::string &algorithm,
+      std::vector<size_t> &tid, std::vector<size_t> &cid,
+      double maxdelta=0.25, uint64_t seed=42);
+  };
 
 #endif
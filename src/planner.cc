@@ -0,0 +1,164 @@
+#include <cmath>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <exception>
+#include "planner.h"
+#include "skyindex.h"
+#include "error_handling.h"
+
+using namespace std;
+
+namespace {
+
+constexpr double degr2rad=3.141592653589793238462643383279502884197/180.;
+
+/*! Returns the angular distance (in degrees) between two pointings. */
+double angular_distance (const Pointing &a, const Pointing &b)
+  {
+  double sd=sin(0.5*(a.dec-b.dec)*degr2rad),
+         sa=sin(0.5*(a.ra-b.ra)*degr2rad);
+  double h=sd*sd+cos(a.dec*degr2rad)*cos(b.dec*degr2rad)*sa*sa;
+  return 2*asin(sqrt(min(1.,h)))/degr2rad;
+  }
+
+} // unnamed namespace
+
+projection_func tangentPlaneProjection (double scale)
+  {
+  return [scale](const Pointing &p, const double *ra, const double *dec,
+    size_t n, vec2 *pos)
+    {
+    double a0=p.ra*degr2rad, d0=p.dec*degr2rad,
+           sd0=sin(d0), cd0=cos(d0),
+           cp=cos(p.posang*degr2rad), sp=sin(p.posang*degr2rad),
+           fct=scale/degr2rad;
+    for (size_t i=0; i<n; ++i)
+      {
+      double da=ra[i]*degr2rad-a0, d=dec[i]*degr2rad;
+      double cd=cos(d), sd=sin(d), cda=cos(da);
+      double cosc=sd0*sd+cd0*cd*cda;
+      double x=fct*cd*sin(da)/cosc, y=fct*(cd0*sd-sd0*cd*cda)/cosc;
+      pos[i]=vec2(x*cp-y*sp, x*sp+y*cp);
+      }
+    };
+  }
+
+void planSurvey (const double *ra, const double *dec, const int *pri,
+  double *remaining, size_t ntgt, const vector<Pointing> &pointings,
+  const vector<Cobra> &cobras, const string &algorithm,
+  const projection_func &project, const tile_result_func &result,
+  double radius, size_t nthreads, size_t maxactive, uint64_t seed)
+  {
+  auto algs=getAssigners();
+  planck_assert(find(algs.begin(),algs.end(),algorithm)!=algs.end(),
+    "unknown assignment algorithm");
+  if (nthreads==0)
+    nthreads=max<size_t>(1,thread::hardware_concurrency());
+  if (maxactive==0) maxactive=2*nthreads;
+  size_t ntile=pointings.size();
+  SkyIndex index(ra, dec, ntgt);
+
+  // Two tiles overlap if a target can lie within radius of both; their
+  // candidate targets are disjoint otherwise, so that they can be processed
+  // concurrently without changing the result.
+  auto overlap=[&](size_t i, size_t j)
+    { return angular_distance(pointings[i],pointings[j])<=2*radius; };
+
+  auto process=[&](ETSContext &ctx, size_t tile, vector<size_t> &tid,
+    vector<size_t> &cid)
+    {
+    const auto &p(pointings[tile]);
+    vector<size_t> idx;
+    for (auto i : index.query(p.ra, p.dec, radius))
+      if (remaining[i]>0) idx.push_back(i);
+    vector<double> tra(idx.size()), tdec(idx.size());
+    for (size_t k=0; k<idx.size(); ++k)
+      { tra[k]=ra[idx[k]]; tdec[k]=dec[idx[k]]; }
+    vector<vec2> pos(idx.size());
+    if (!idx.empty())
+      project(p, tra.data(), tdec.data(), idx.size(), pos.data());
+    vector<Target> tgt;
+    tgt.reserve(idx.size());
+    for (size_t k=0; k<idx.size(); ++k)
+      tgt.emplace_back(pos[k], remaining[idx[k]], pri[idx[k]]);
+    ctx.setTargets(tgt);
+    ctx.getObservation(algorithm, tid, cid, seed+tile);
+    for (auto &t : tid)
+      {
+      t=idx[t];
+      remaining[t]-=p.exptime;
+      }
+    };
+
+  mutex mtx;
+  condition_variable cv;
+  size_t next=0, nreported=0;
+  vector<size_t> running;
+  map<size_t, pair<vector<size_t>, vector<size_t>>> finished;
+  exception_ptr ex;
+  bool abort=false;
+
+  // a tile may start once fewer than maxactive tiles are waiting to be
+  // reported and no running tile overlaps it
+  auto can_start=[&]()
+    {
+    if (next-nreported>=maxactive) return false;
+    for (auto t : running)
+      if (overlap(t,next)) return false;
+    return true;
+    };
+
+  auto worker=[&]()
+    {
+    ETSContext ctx(cobras, 1);
+    unique_lock<mutex> lock(mtx);
+    while (true)
+      {
+      cv.wait(lock, [&]{ return abort || (next==ntile) || can_start(); });
+      if (abort || (next==ntile)) break;
+      size_t tile=next++;
+      running.push_back(tile);
+      lock.unlock();
+      vector<size_t> tid, cid;
+      try
+        { process(ctx, tile, tid, cid); }
+      catch (...)
+        {
+        lock.lock();
+        if (!ex) ex=current_exception();
+        abort=true;
+        cv.notify_all();
+        break;
+        }
+      lock.lock();
+      running.erase(find(running.begin(),running.end(),tile));
+      finished[tile]=make_pair(move(tid),move(cid));
+      try
+        {
+        while ((!finished.empty()) && (finished.begin()->first==nreported))
+          {
+          const auto &res(finished.begin()->second);
+          result(nreported, res.first, res.second);
+          finished.erase(finished.begin());
+          ++nreported;
+          }
+        }
+      catch (...)
+        {
+        if (!ex) ex=current_exception();
+        abort=true;
+        }
+      cv.notify_all();
+      }
+    };
+
+  vector<thread> threads;
+  for (size_t i=1; i<min(nthreads,ntile); ++i)
+    threads.emplace_back(worker);
+  worker();
+  for (auto &t : threads) t.join();
+  if (ex) rethrow_exception(ex);
+  }
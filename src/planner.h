@@ -0,0 +1,83 @@
+/*
+ *  This file is part of ets_fiber_assigner.
+ *
+ *  ets_fiber_assigner is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ets_fiber_assigner is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ets_fiber_assigner; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ *  ets_fiber_assigner is being developed at the Max-Planck-Institut fuer
+ *  Astrophysik.
+ */
+
+#ifndef ETS_PLANNER_H
+#define ETS_PLANNER_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "ets.h"
+
+/*! Telescope pointing of a single survey tile; all angles in degrees. */
+class Pointing
+  {
+  public:
+    double ra, dec, posang;
+    double exptime; // exposure time in seconds
+
+    Pointing (double ra_, double dec_, double posang_, double exptime_)
+      : ra(ra_), dec(dec_), posang(posang_), exptime(exptime_) {}
+  };
+
+/*! Computes the focal plane positions \a pos of the \a n sky positions
+    \a ra, \a dec (in degrees) for the pointing \a p. */
+using projection_func = std::function<void(const Pointing &p,
+  const double *ra, const double *dec, size_t n, vec2 *pos)>;
+
+/*! Receives the result of tile \a tile: catalog target tid[i] is observed by
+    cobra cid[i]. */
+using tile_result_func = std::function<void(size_t tile,
+  const std::vector<size_t> &tid, const std::vector<size_t> &cid)>;
+
+/*! Returns a gnomonic projection around the pointing center, rotated by the
+    position angle and scaled by \a scale mm per degree. This is only an
+    approximation of the real PFS optics, good enough for planning. */
+projection_func tangentPlaneProjection (double scale);
+
+/*! Plans a survey of the \a ntgt catalog targets with the sky positions
+    \a ra, \a dec (in degrees) and priorities \a pri; \a remaining holds
+    their requested observation times (in seconds) on input and the times
+    still missing on output.
+    The \a pointings are processed in order. For every one, the targets
+    within \a radius degrees of its center that still need observation time
+    are projected to the focal plane with \a project and assigned to the
+    \a cobras with \a algorithm (see getAssigners(); the seed of tile k is
+    \a seed+k). The observed targets have the tile's exposure time subtracted
+    from their remaining time before any later tile overlapping this one is
+    started, and \a result is called for all tiles, in order.
+    Tiles that do not overlap are processed concurrently on \a nthreads
+    threads (0 means one per hardware thread), each reusing one ETSContext;
+    at most \a maxactive tiles (0 means 2*nthreads) are started but not yet
+    passed to \a result, which bounds the memory use. The results are the
+    same as for sequential processing. \a project may be called
+    concurrently from several threads; calls of \a result are serialized. */
+void planSurvey (const double *ra, const double *dec, const int *pri,
+  double *remaining, size_t ntgt, const std::vector<Pointing> &pointings,
+  const std::vector<Cobra> &cobras, const std::string &algorithm,
+  const projection_func &project, const tile_result_func &result,
+  double radius=0.75, size_t nthreads=1, size_t maxactive=0,
+  uint64_t seed=42);
+
+#endif
@@ -1,9 +1,13 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 #include <pybind11/complex.h>
+#include <pybind11/numpy.h>
 
 #include "string_utils.h"
 #include "ets.h"
+#include "catalog.h"
+#include "skyindex.h"
+#include "planner.h"
 #include "ets_helpers.h"
 
 using namespace std;
@@ -12,6 +16,27 @@ namespace {
 
 namespace py = pybind11;
 
+/*! Cobra description as stored in NumPy structured arrays. */
+struct CobraRecord
+  {
+  complex<double> center;
+  double l1, l2;
+  complex<double> dotpos;
+  double rdot;
+  };
+
+/*! Returns a 1D NumPy array sharing its memory with \a v, which is moved
+    into storage owned by the array. */
+template<typename Tout, typename T> py::array_t<Tout> vec2array
+  (vector<T> &&v)
+  {
+  static_assert(sizeof(Tout)==sizeof(T), "type size mismatch");
+  auto *ptr = new vector<T>(move(v));
+  py::capsule owner(ptr, [](void *p) { delete reinterpret_cast<vector<T> *>(p); });
+  return py::array_t<Tout>(ptr->size(),
+    reinterpret_cast<const Tout *>(ptr->data()), owner);
+  }
+
 py::list getAllCobras()
   {
   auto c=makeCobras();
@@ -30,24 +55,61 @@ py::list getAllCobras()
   return res;
   }
 
+vector<Cobra> list2cobras(const py::list &cbr)
+  {
+  vector<Cobra> res;
+  for (auto i:cbr)
+    {
+    planck_assert(i.cast<py::list>().size()==5,"format mismatch");
+    res.emplace_back(i[py::cast(0)].cast<complex<double>>(),
+                     i[py::cast(1)].cast<double>(),
+                     i[py::cast(2)].cast<double>(),
+                     i[py::cast(3)].cast<complex<double>>(),
+                     i[py::cast(4)].cast<double>());
+    }
+  return res;
+  }
+
+using cobra_array = py::array_t<CobraRecord,
+  py::array::c_style | py::array::forcecast>;
+using cdouble_array = py::array_t<complex<double>,
+  py::array::c_style | py::array::forcecast>;
+using double_array = py::array_t<double,
+  py::array::c_style | py::array::forcecast>;
+using int_array = py::array_t<int, py::array::c_style | py::array::forcecast>;
+using size_t_array = py::array_t<size_t,
+  py::array::c_style | py::array::forcecast>;
+
+vector<Cobra> array2cobras(const cobra_array &cbr)
+  {
+  planck_assert(cbr.ndim()==1, "cobra array must be one-dimensional");
+  auto c = cbr.unchecked<1>();
+  vector<Cobra> res;
+  res.reserve(c.shape(0));
+  for (py::ssize_t i=0; i<c.shape(0); ++i)
+    res.emplace_back(c(i).center, c(i).l1, c(i).l2, c(i).dotpos, c(i).rdot);
+  return res;
+  }
+
+py::array_t<CobraRecord> getAllCobrasArray()
+  {
+  auto c=makeCobras();
+  py::array_t<CobraRecord> res(c.size());
+  auto r = res.mutable_unchecked<1>();
+  for (size_t i=0; i<c.size(); ++i)
+    r(i) = CobraRecord{c[i].center, c[i].l1, c[i].l2, c[i].dotpos, c[i].rdot};
+  return res;
+  }
+
 map<size_t,vector<size_t>> getVis(const vector<complex<double>> &t_pos,
-  const py::list &cbr)
+  const py::list &cbr, size_t nthreads)
   {
   vector<Target> tgt;
   for (size_t i=0; i<t_pos.size(); ++i)
     tgt.emplace_back(t_pos[i],1.,1);
 
-  vector<Cobra> cobras;
-  for (auto i:cbr)
-    {
-    planck_assert(i.cast<py::list>().size()==5,"format mismatch");
-    cobras.emplace_back(i[py::cast(0)].cast<complex<double>>(),
-                        i[py::cast(1)].cast<double>(),
-                        i[py::cast(2)].cast<double>(),
-                        i[py::cast(3)].cast<complex<double>>(),
-                        i[py::cast(4)].cast<double>());
-    }
-  auto tmp = getT2F(tgt,cobras);
+  auto cobras = list2cobras(cbr);
+  auto tmp = getT2F(tgt,cobras,nthreads);
   map<size_t,vector<size_t>> res;
   for (size_t i=0; i< tmp.size(); ++i)
     if (tmp[i].size()>0) res[i]=tmp[i];
@@ -58,7 +120,8 @@ map<size_t,size_t> getObs(const vector<complex<double>> &t_pos,
                           const vector<double> &t_time,
                           const vector<int> &t_pri,
                           const py::list &cbr,
-                          const string &assigner)
+                          const string &assigner,
+                          size_t nthreads, uint64_t seed)
   {
   planck_assert((t_pos.size()==t_time.size())
               &&(t_pos.size()==t_pri.size()), "vector length mismatch");
@@ -66,38 +129,496 @@ map<size_t,size_t> getObs(const vector<complex<double>> &t_pos,
   for (size_t i=0; i<t_pos.size(); ++i)
     tgt.emplace_back(t_pos[i],t_time[i],t_pri[i]);
 
-  vector<Cobra> cobras;
-  for (auto i:cbr)
-    {
-    planck_assert(i.cast<py::list>().size()==5,"format mismatch");
-    cobras.emplace_back(i[py::cast(0)].cast<complex<double>>(),
-                        i[py::cast(1)].cast<double>(),
-                        i[py::cast(2)].cast<double>(),
-                        i[py::cast(3)].cast<complex<double>>(),
-                        i[py::cast(4)].cast<double>());
-    }
+  auto cobras = list2cobras(cbr);
 
   vector<size_t> tid, fid;
   if (!tgt.empty())
-    getObservation(tgt,cobras,assigner,tid,fid);
+    getObservation(tgt,cobras,assigner,tid,fid,nthreads,seed);
   map<size_t,size_t> res;
   for (size_t i=0; i<tid.size(); ++i)
     res[tid[i]] = fid[i];
   return res;
   }
 
+using VisDict = map<size_t,vector<pair<size_t,complex<double>>>>;
+
+vector<VisDict> getVisMulti(
+  const py::array_t<complex<double>,
+    py::array::c_style | py::array::forcecast> &t_pos,
+  const py::list &cbr, size_t nthreads)
+  {
+  planck_assert(t_pos.ndim()==2, "t_pos must be a 2D array");
+  size_t nvisit=t_pos.shape(0), ntgt=t_pos.shape(1);
+  auto cobras = list2cobras(cbr);
+  vector<TargetVisibility> vis;
+  {
+  py::gil_scoped_release release;
+  vis = ::getVisMulti(t_pos.data(),nvisit,ntgt,cobras,nthreads);
+  }
+  vector<VisDict> res(nvisit);
+  for (size_t v=0; v<nvisit; ++v)
+    for (size_t i=0; i<ntgt; ++i)
+      if (vis[v].ofs[i+1]>vis[v].ofs[i])
+        {
+        auto &entry(res[v][i]);
+        for (size_t k=vis[v].ofs[i]; k<vis[v].ofs[i+1]; ++k)
+          entry.emplace_back(vis[v].cobra[k],vis[v].elbow[k]);
+        }
+  return res;
+  }
+
+py::tuple getVisArrays(const cdouble_array &t_pos, const cobra_array &cbr,
+  size_t nthreads)
+  {
+  planck_assert(t_pos.ndim()==1, "t_pos must be a 1D array");
+  auto cobras = array2cobras(cbr);
+  vector<TargetVisibility> vis;
+  {
+  py::gil_scoped_release release;
+  vis = ::getVisMulti(t_pos.data(),1,t_pos.shape(0),cobras,nthreads);
+  }
+  return py::make_tuple(vec2array<size_t>(move(vis[0].ofs)),
+                        vec2array<size_t>(move(vis[0].cobra)),
+                        vec2array<complex<double>>(move(vis[0].elbow)));
+  }
+
+vector<Target> arrays2targets(const cdouble_array &t_pos,
+  const double_array &t_time, const int_array &t_pri)
+  {
+  planck_assert((t_pos.ndim()==1)&&(t_time.ndim()==1)&&(t_pri.ndim()==1),
+    "input arrays must be one-dimensional");
+  size_t ntgt=t_pos.shape(0);
+  planck_assert((size_t(t_time.shape(0))==ntgt)&&(size_t(t_pri.shape(0))==ntgt),
+    "vector length mismatch");
+  const complex<double> *pos=t_pos.data();
+  const double *time=t_time.data();
+  const int *pri=t_pri.data();
+  vector<Target> tgt;
+  tgt.reserve(ntgt);
+  for (size_t i=0; i<ntgt; ++i)
+    tgt.emplace_back(pos[i],time[i],pri[i]);
+  return tgt;
+  }
+
+/*! Returns the tuple (tid, cid), extended by \a hit if \a return_hit is
+    set. */
+py::tuple obs_tuple (vector<size_t> &&tid, vector<size_t> &&cid, bool hit,
+  bool return_hit)
+  {
+  auto res = py::make_tuple(vec2array<size_t>(move(tid)),
+                            vec2array<size_t>(move(cid)));
+  return return_hit ? py::make_tuple(res[0], res[1], hit) : res;
+  }
+
+py::tuple getObsArrays(const cdouble_array &t_pos,
+  const double_array &t_time, const int_array &t_pri,
+  const cobra_array &cbr, const string &assigner, size_t nthreads,
+  uint64_t seed, double maxtime, size_t maxiter, bool return_hit)
+  {
+  auto tgt = arrays2targets(t_pos, t_time, t_pri);
+  auto cobras = array2cobras(cbr);
+  vector<size_t> tid, cid;
+  bool hit=false;
+  {
+  py::gil_scoped_release release;
+  if (!tgt.empty())
+    hit=getObservation(tgt,cobras,assigner,tid,cid,nthreads,seed,
+      AssignmentBudget(maxtime,maxiter));
+  }
+  return obs_tuple(move(tid), move(cid), hit, return_hit);
+  }
+
+py::tuple getMultiVisitObs(const cdouble_array &t_pos,
+  const double_array &t_time, const int_array &t_pri,
+  const py::array_t<size_t, py::array::c_style | py::array::forcecast> &t_cls,
+  const vector<bool> &calib, const vector<size_t> &minobs,
+  const cobra_array &cbr, const string &assigner, double tvisit,
+  size_t nthreads, uint64_t seed)
+  {
+  planck_assert(t_pos.ndim()==2, "t_pos must be a 2D array");
+  size_t nvisit=t_pos.shape(0), ntgt=t_pos.shape(1);
+  planck_assert((t_time.ndim()==1)&&(t_pri.ndim()==1)&&(t_cls.ndim()==1),
+    "target arrays must be one-dimensional");
+  planck_assert((size_t(t_time.shape(0))==ntgt)&&(size_t(t_pri.shape(0))==ntgt)
+    &&(size_t(t_cls.shape(0))==ntgt), "vector length mismatch");
+  auto cobras = array2cobras(cbr);
+  vector<uint8_t> cal(calib.begin(), calib.end());
+  vector<vector<size_t>> tid, cid;
+  vector<double> remaining;
+  {
+  py::gil_scoped_release release;
+  getMultiVisitObservation(t_pos.data(),nvisit,ntgt,t_time.data(),
+    t_pri.data(),t_cls.data(),cal,minobs,cobras,assigner,tvisit,tid,cid,
+    remaining,nthreads,seed);
+  }
+  py::list res;
+  for (size_t v=0; v<nvisit; ++v)
+    res.append(py::make_tuple(vec2array<size_t>(move(tid[v])),
+                              vec2array<size_t>(move(cid[v]))));
+  return py::make_tuple(res, vec2array<double>(move(remaining)));
+  }
+
+py::dict compareAssigners(const cdouble_array &t_pos,
+  const double_array &t_time, const int_array &t_pri,
+  const cobra_array &cbr, const vector<string> &assigners, size_t nthreads,
+  uint64_t seed)
+  {
+  auto tgt = arrays2targets(t_pos, t_time, t_pri);
+  auto cobras = array2cobras(cbr);
+  vector<vector<size_t>> tid(assigners.size()), cid(assigners.size());
+  {
+  py::gil_scoped_release release;
+  if (!tgt.empty())
+    getObservations(tgt,cobras,assigners,tid,cid,nthreads,seed);
+  }
+  py::dict res;
+  for (size_t i=0; i<assigners.size(); ++i)
+    res[py::cast(assigners[i])] = py::make_tuple(
+      vec2array<size_t>(move(tid[i])), vec2array<size_t>(move(cid[i])));
+  return res;
+  }
+
+py::tuple getBestObs(const cdouble_array &t_pos, const double_array &t_time,
+  const int_array &t_pri, const cobra_array &cbr, const string &assigner,
+  size_t nstarts, const string &score, size_t nthreads, uint64_t seed)
+  {
+  auto tgt = arrays2targets(t_pos, t_time, t_pri);
+  auto cobras = array2cobras(cbr);
+  vector<size_t> tid, cid;
+  {
+  py::gil_scoped_release release;
+  if (!tgt.empty())
+    getBestObservation(tgt,cobras,assigner,nstarts,score,tid,cid,nthreads,
+      seed);
+  }
+  return py::make_tuple(vec2array<size_t>(move(tid)),
+                        vec2array<size_t>(move(cid)));
+  }
+
+void ctx_setTargets(ETSContext &ctx, const cdouble_array &t_pos,
+  const double_array &t_time, const int_array &t_pri)
+  {
+  auto tgt = arrays2targets(t_pos, t_time, t_pri);
+  py::gil_scoped_release release;
+  ctx.setTargets(tgt);
+  }
+
+void ctx_updateTargets(ETSContext &ctx, const double_array &t_time,
+  const int_array &t_pri)
+  {
+  planck_assert((t_time.ndim()==1)&&(t_pri.ndim()==1),
+    "input arrays must be one-dimensional");
+  vector<double> time(t_time.data(), t_time.data()+t_time.shape(0));
+  vector<int> pri(t_pri.data(), t_pri.data()+t_pri.shape(0));
+  py::gil_scoped_release release;
+  ctx.updateTargets(time, pri);
+  }
+
+py::tuple ctx_getObs(ETSContext &ctx, const string &assigner, uint64_t seed,
+  double maxtime, size_t maxiter, bool return_hit)
+  {
+  vector<size_t> tid, cid;
+  bool hit;
+  {
+  py::gil_scoped_release release;
+  hit=ctx.getObservation(assigner,tid,cid,seed,
+    AssignmentBudget(maxtime,maxiter));
+  }
+  return obs_tuple(move(tid), move(cid), hit, return_hit);
+  }
+
+void ctx_addTargets(ETSContext &ctx, const cdouble_array &t_pos,
+  const double_array &t_time, const int_array &t_pri)
+  {
+  auto tgt = arrays2targets(t_pos, t_time, t_pri);
+  py::gil_scoped_release release;
+  ctx.addTargets(tgt);
+  }
+
+void ctx_removeTargets(ETSContext &ctx, const vector<size_t> &idx)
+  {
+  py::gil_scoped_release release;
+  ctx.removeTargets(idx);
+  }
+
+py::tuple ctx_getObsIncremental(ETSContext &ctx, const string &assigner,
+  double maxdelta, uint64_t seed)
+  {
+  vector<size_t> tid, cid;
+  {
+  py::gil_scoped_release release;
+  ctx.getObservationIncremental(assigner,tid,cid,maxdelta,seed);
+  }
+  return py::make_tuple(vec2array<size_t>(move(tid)),
+                        vec2array<size_t>(move(cid)));
+  }
+
+py::dict ctx_compareAssigners(ETSContext &ctx, const vector<string> &assigners,
+  uint64_t seed)
+  {
+  vector<vector<size_t>> tid, cid;
+  {
+  py::gil_scoped_release release;
+  ctx.getObservations(assigners,tid,cid,seed);
+  }
+  py::dict res;
+  for (size_t i=0; i<assigners.size(); ++i)
+    res[py::cast(assigners[i])] = py::make_tuple(
+      vec2array<size_t>(move(tid[i])), vec2array<size_t>(move(cid[i])));
+  return res;
+  }
+
+py::tuple ctx_getBestObs(ETSContext &ctx, const string &assigner,
+  size_t nstarts, const string &score, uint64_t seed)
+  {
+  vector<size_t> tid, cid;
+  {
+  py::gil_scoped_release release;
+  ctx.getBestObservation(assigner,nstarts,score,tid,cid,seed);
+  }
+  return py::make_tuple(vec2array<size_t>(move(tid)),
+                        vec2array<size_t>(move(cid)));
+  }
+
+map<size_t,vector<size_t>> ctx_getVis(ETSContext &ctx)
+  {
+  vector<vector<size_t>> tmp;
+  {
+  py::gil_scoped_release release;
+  tmp = ctx.T2F();
+  }
+  map<size_t,vector<size_t>> res;
+  for (size_t i=0; i< tmp.size(); ++i)
+    if (tmp[i].size()>0) res[i]=tmp[i];
+  return res;
+  }
+
+/*! Checks that \a ofs are valid offsets of a visibility table for \a ntgt
+    targets, i.e. that they start at 0 and do not decrease; returns the
+    number of table entries. */
+size_t checkOffsets(const size_t_array &ofs, size_t ntgt)
+  {
+  planck_assert(size_t(ofs.shape(0))==ntgt+1, "array size mismatch");
+  auto o=ofs.data();
+  planck_assert(o[0]==0, "offsets must start at 0");
+  for (size_t i=0; i<ntgt; ++i)
+    planck_assert(o[i+1]>=o[i], "offsets must not decrease");
+  return o[ntgt];
+  }
+
+py::tuple getCollidingPairs(const cdouble_array &t_pos,
+  const size_t_array &offsets, double dist, size_t nthreads)
+  {
+  planck_assert((t_pos.ndim()==1)&&(offsets.ndim()==1),
+    "input arrays must be one-dimensional");
+  size_t ntgt=t_pos.shape(0);
+  checkOffsets(offsets,ntgt);
+  vector<size_t> pi, pj;
+  {
+  py::gil_scoped_release release;
+  ::getCollidingPairs(t_pos.data(),offsets.data(),ntgt,dist,pi,pj,nthreads);
+  }
+  return py::make_tuple(vec2array<size_t>(move(pi)),
+                        vec2array<size_t>(move(pj)));
+  }
+
+py::tuple getElbowCollisions(const cdouble_array &t_pos,
+  const size_t_array &offsets, const size_t_array &cobra_idx,
+  const cdouble_array &elbow, double dist, size_t nthreads)
+  {
+  planck_assert((t_pos.ndim()==1)&&(offsets.ndim()==1)&&(cobra_idx.ndim()==1)
+    &&(elbow.ndim()==1), "input arrays must be one-dimensional");
+  size_t ntgt=t_pos.shape(0);
+  size_t nedge=checkOffsets(offsets,ntgt);
+  planck_assert((size_t(cobra_idx.shape(0))==nedge)
+    &&(size_t(elbow.shape(0))==nedge), "array size mismatch");
+  vector<size_t> ofs, blocked;
+  {
+  py::gil_scoped_release release;
+  ::getElbowCollisions(t_pos.data(),ntgt,offsets.data(),cobra_idx.data(),
+    elbow.data(),dist,ofs,blocked,nthreads);
+  }
+  return py::make_tuple(vec2array<size_t>(move(ofs)),
+                        vec2array<size_t>(move(blocked)));
+  }
+
+py::tuple getTargetComponents(size_t ntgt,
+  const py::array_t<size_t, py::array::c_style | py::array::forcecast> &etgt,
+  const py::array_t<size_t, py::array::c_style | py::array::forcecast> &egroup,
+  const py::array_t<size_t, py::array::c_style | py::array::forcecast> &pi,
+  const py::array_t<size_t, py::array::c_style | py::array::forcecast> &pj)
+  {
+  planck_assert((etgt.ndim()==1)&&(egroup.ndim()==1)&&(pi.ndim()==1)
+    &&(pj.ndim()==1), "input arrays must be one-dimensional");
+  size_t nedge=etgt.shape(0), npair=pi.shape(0);
+  planck_assert((size_t(egroup.shape(0))==nedge)&&(size_t(pj.shape(0))==npair),
+    "array size mismatch");
+  vector<size_t> label;
+  size_t ncomp;
+  {
+  py::gil_scoped_release release;
+  ncomp=::getTargetComponents(ntgt,etgt.data(),egroup.data(),nedge,
+    pi.data(),pj.data(),npair,label);
+  }
+  vector<int64_t> res(label.size());
+  for (size_t i=0; i<label.size(); ++i)
+    res[i] = (label[i]==~size_t(0)) ? -1 : int64_t(label[i]);
+  return py::make_tuple(vec2array<int64_t>(move(res)), ncomp);
+  }
+
+/*! Returns a read-only NumPy view of the catalog column \a data, which keeps
+    the catalog object \a owner alive. */
+template<typename T> py::array catalog_column(const T *data, size_t n,
+  py::handle owner)
+  {
+  py::array_t<T> res(n, data, owner);
+  res.attr("flags").attr("writeable") = false;
+  return res;
+  }
+
+py::array catalog_ids(py::object self)
+  {
+  const auto &cat(self.cast<const TargetCatalog &>());
+  size_t w=cat.idWidth();
+  py::array res(py::dtype("S"+dataToString(w)), {py::ssize_t(cat.size())},
+    {py::ssize_t(w)}, cat.ids(), self);
+  res.attr("flags").attr("writeable") = false;
+  return res;
+  }
+
+void writeCatalog(const string &filename, const vector<string> &ids,
+  const vector<double> &ra, const vector<double> &dec,
+  const vector<double> &time, const vector<int32_t> &pri,
+  const vector<int32_t> &cls, const vector<string> &classes,
+  const vector<bool> &calib)
+  {
+  vector<uint8_t> flags(calib.begin(), calib.end());
+  py::gil_scoped_release release;
+  writeTargetCatalog(filename,ids,ra,dec,time,pri,cls,classes,flags);
+  }
+
+/*! Wraps the Python callable \a func(pointing, ra, dec), which returns the
+    complex focal plane positions, as a projection_func. */
+projection_func py2projection(py::object func)
+  {
+  return [func](const Pointing &p, const double *ra, const double *dec,
+    size_t n, vec2 *pos)
+    {
+    py::gil_scoped_acquire acquire;
+    py::array_t<double> a_ra(n, ra), a_dec(n, dec);
+    auto res = cdouble_array::ensure(
+      func(py::make_tuple(p.ra,p.dec,p.posang,p.exptime), a_ra, a_dec));
+    planck_assert(res && (res.ndim()==1) && (size_t(res.shape(0))==n),
+      "projection returned an array of the wrong size");
+    for (size_t i=0; i<n; ++i) pos[i]=res.data()[i];
+    };
+  }
+
+py::tuple planSurvey(const double_array &ra, const double_array &dec,
+  const double_array &time, const int_array &pri, const double_array &pnt,
+  const cobra_array &cbr, const string &assigner, py::object projection,
+  py::object callback, double radius, size_t nthreads, size_t maxactive,
+  uint64_t seed)
+  {
+  planck_assert((ra.ndim()==1)&&(dec.ndim()==1)&&(time.ndim()==1)
+    &&(pri.ndim()==1), "input arrays must be one-dimensional");
+  size_t ntgt=ra.shape(0);
+  planck_assert((size_t(dec.shape(0))==ntgt)&&(size_t(time.shape(0))==ntgt)
+    &&(size_t(pri.shape(0))==ntgt), "array size mismatch");
+  planck_assert((pnt.ndim()==2)&&(pnt.shape(1)==4),
+    "pointings must have the shape (n,4)");
+  vector<Pointing> pointings;
+  for (py::ssize_t i=0; i<pnt.shape(0); ++i)
+    pointings.emplace_back(pnt.at(i,0), pnt.at(i,1), pnt.at(i,2),
+      pnt.at(i,3));
+  auto cobras = array2cobras(cbr);
+  auto project = (py::isinstance<py::float_>(projection)
+                  || py::isinstance<py::int_>(projection)) ?
+    tangentPlaneProjection(projection.cast<double>()) :
+    py2projection(projection);
+  vector<double> remaining(time.data(), time.data()+ntgt);
+  vector<pair<vector<size_t>,vector<size_t>>> results;
+  tile_result_func result;
+  if (callback.is_none())
+    result = [&results](size_t, const vector<size_t> &tid,
+      const vector<size_t> &cid)
+      { results.emplace_back(tid, cid); };
+  else
+    result = [&callback](size_t tile, const vector<size_t> &tid,
+      const vector<size_t> &cid)
+      {
+      py::gil_scoped_acquire acquire;
+      callback(tile, py::array_t<size_t>(tid.size(), tid.data()),
+        py::array_t<size_t>(cid.size(), cid.data()));
+      };
+  {
+  py::gil_scoped_release release;
+  ::planSurvey(ra.data(), dec.data(), pri.data(), remaining.data(), ntgt,
+    pointings, cobras, assigner, project, result, radius, nthreads, maxactive,
+    seed);
+  }
+  py::object res = py::none();
+  if (callback.is_none())
+    {
+    py::list lst;
+    for (auto &r : results)
+      lst.append(py::make_tuple(vec2array<size_t>(move(r.first)),
+                                vec2array<size_t>(move(r.second))));
+    res = lst;
+    }
+  return py::make_tuple(vec2array<double>(move(remaining)), res);
+  }
+
+/*! Python-side ETSStats, usable as a context manager; the statistics are
+    collected between __enter__() and __exit__() and kept afterwards. */
+struct PyStats
+  {
+  unique_ptr<ETSStats> stats;
+  map<string,double> res;
+
+  void enter()
+    {
+    planck_assert(!stats, "statistics are already being collected");
+    stats.reset(new ETSStats);
+    }
+  void exit()
+    {
+    if (!stats) return;
+    res = stats->values();
+    stats.reset();
+    }
+  map<string,double> values() const
+    { return stats ? stats->values() : res; }
+  };
+
 } // unnamed namespace
 
 PYBIND11_MODULE(pyETS,m)
   {
   using namespace pybind11::literals;
   m.doc() = "Python interface for some of the ETS C++ functionality";
+  PYBIND11_NUMPY_DTYPE(CobraRecord, center, l1, l2, dotpos, rdot);
   m.def("getVis", &getVis,
     "returns a list of the visible targets and the fibers that can observe them.\n"
     "Args:\n"
     "  t_pos  : Target x/y coordinates on the focal plane (in mm)\n"
     "  cbr    : list of cobras as generated by getAllCobras()\n"
-    "t_pos"_a, "cbr"_a);
+    "  nthreads: number of threads used for the computation\n"
+    "            (0: use all available hardware threads)\n",
+    "t_pos"_a, "cbr"_a, "nthreads"_a=1);
+  m.def("getVisMulti", &getVisMulti,
+    "returns, for several visits at once, the visible targets and the fibers\n"
+    "that can observe them, together with the corresponding elbow positions.\n"
+    "Args:\n"
+    "  t_pos  : 2D array of target x/y coordinates on the focal plane (in mm)\n"
+    "           with shape (nvisit, ntarget)\n"
+    "  cbr    : list of cobras as generated by getAllCobras()\n"
+    "  nthreads: number of threads used for the computation\n"
+    "            (0: use all available hardware threads)\n"
+    "Returns:\n"
+    "  a list with one dictionary per visit, mapping target indices to lists\n"
+    "  of (cobra index, elbow position) tuples\n",
+    "t_pos"_a, "cbr"_a, "nthreads"_a=1);
   m.def("getObs", &getObs,
     "performs an assignment step and returns a dictionary containing the\n"
     "observed target numbers and the assigned cobra numbers\n"
@@ -106,9 +627,390 @@ PYBIND11_MODULE(pyETS,m)
     "  t_time  : requested target observation times (in seconds) (unused)\n"
     "  t_pri   : target priorities\n"
     "  cbr     : list of cobras as generated by getAllCobras()\n"
-    "  assigner: algorithm to do the assignment. Must be one of 'naive',\n"
-    "            'draining', 'draining_closest' or 'new'\n",
-    "t_pos"_a, "t_time"_a, "t_pri"_a, "cbr"_a, "assigner"_a);
+    "  assigner: algorithm to do the assignment. Must be one of the names\n"
+    "            returned by getAssigners(), e.g. 'naive', 'draining',\n"
+    "            'draining_closest' or 'new'\n"
+    "  nthreads: number of threads used for the visibility computation\n"
+    "            (0: use all available hardware threads)\n"
+    "  seed    : seed for the random tie-breaking of some algorithms\n",
+    "t_pos"_a, "t_time"_a, "t_pri"_a, "cbr"_a, "assigner"_a, "nthreads"_a=1,
+    "seed"_a=42);
+  m.def("getVisArrays", &getVisArrays,
+    "returns the visibility information for a set of targets as compressed\n"
+    "arrays\n"
+    "Args:\n"
+    "  t_pos  : 1D array of target x/y coordinates on the focal plane (in mm)\n"
+    "  cbr    : structured array of cobras as generated by getAllCobrasArray()\n"
+    "  nthreads: number of threads used for the computation\n"
+    "            (0: use all available hardware threads)\n"
+    "Returns:\n"
+    "  a tuple (offsets, cobra_idx, elbow): the cobras able to observe\n"
+    "  target i are cobra_idx[offsets[i]:offsets[i+1]], and the\n"
+    "  corresponding elbow positions (complex) are found at the same indices\n"
+    "  of elbow\n",
+    "t_pos"_a, "cbr"_a, "nthreads"_a=1);
+  m.def("getObsArrays", &getObsArrays,
+    "performs an assignment step and returns arrays containing the\n"
+    "observed target numbers and the assigned cobra numbers\n"
+    "Args:\n"
+    "  t_pos   : 1D array of target x/y coordinates on the focal plane (in mm)\n"
+    "  t_time  : requested target observation times (in seconds) (unused)\n"
+    "  t_pri   : target priorities\n"
+    "  cbr     : structured array of cobras as generated by getAllCobrasArray()\n"
+    "  assigner: algorithm to do the assignment. Must be one of the names\n"
+    "            returned by getAssigners(), e.g. 'naive', 'draining',\n"
+    "            'draining_closest' or 'new'\n"
+    "  nthreads: number of threads used for the visibility computation\n"
+    "            (0: use all available hardware threads)\n"
+    "  seed    : seed for the random tie-breaking of some algorithms\n"
+    "  maxtime : if >0, time limit (in seconds, including the setup); once it\n"
+    "            is reached, the remaining fibers are assigned by 'naive'\n"
+    "  maxiter : if >0, maximum number of targets assigned by the algorithm\n"
+    "            before switching to 'naive'\n"
+    "  return_hit: if True, also return whether a limit was reached\n"
+    "Returns:\n"
+    "  a tuple (tid, cid) of equally long arrays; target tid[i] is observed\n"
+    "  by cobra cid[i]. With return_hit=True, the tuple is (tid, cid, hit),\n"
+    "  where hit tells whether maxtime or maxiter was reached.\n",
+    "t_pos"_a, "t_time"_a, "t_pri"_a, "cbr"_a, "assigner"_a, "nthreads"_a=1,
+    "seed"_a=42, "maxtime"_a=0., "maxiter"_a=0, "return_hit"_a=false);
+  m.def("getMultiVisitObs", &getMultiVisitObs,
+    "greedy assignment of several visits, following the network flow model\n"
+    "of netflow.buildProblem(); much faster than the ILP, but suboptimal\n"
+    "Args:\n"
+    "  t_pos   : array of shape (nvisit, ntgt) with the target x/y coordinates\n"
+    "            on the focal plane (in mm) for every visit\n"
+    "  t_time  : requested target observation times (in seconds); science\n"
+    "            target i gets at most t_time[i]/tvisit visits\n"
+    "  t_pri   : target priorities\n"
+    "  t_cls   : class index of every target\n"
+    "  calib   : True for every calibration target class; calibration\n"
+    "            targets can be observed in every visit\n"
+    "  minobs  : minimum number of targets of every calibration target class\n"
+    "            per visit (ignored for science classes)\n"
+    "  cbr     : structured array of cobras as generated by getAllCobrasArray()\n"
+    "  assigner: algorithm for the remaining fibers of every visit (see\n"
+    "            getAssigners())\n"
+    "  tvisit  : duration of a visit (in seconds)\n"
+    "  nthreads: number of threads (0: use all available hardware threads)\n"
+    "  seed    : seed for the random tie-breaking; visit v uses seed+v\n"
+    "Returns:\n"
+    "  a tuple (visits, remaining): a list with a tuple (tid, cid) of target\n"
+    "  and cobra indices for every visit, and the observation times still\n"
+    "  missing for every target\n",
+    "t_pos"_a, "t_time"_a, "t_pri"_a, "t_cls"_a, "calib"_a, "minobs"_a,
+    "cbr"_a, "assigner"_a, "tvisit"_a, "nthreads"_a=1, "seed"_a=42);
+  m.def("compareAssigners", &compareAssigners,
+    "performs an assignment step with several algorithms on the same input;\n"
+    "the visibility computation is only done once\n"
+    "Args:\n"
+    "  t_pos    : 1D array of target x/y coordinates on the focal plane (in mm)\n"
+    "  t_time   : requested target observation times (in seconds) (unused)\n"
+    "  t_pri    : target priorities\n"
+    "  cbr      : structured array of cobras as generated by getAllCobrasArray()\n"
+    "  assigners: list of algorithm names (see getAssigners())\n"
+    "  nthreads : number of threads used for the visibility computation\n"
+    "             (0: use all available hardware threads)\n"
+    "  seed     : seed for the random tie-breaking of some algorithms\n"
+    "Returns:\n"
+    "  a dictionary mapping every algorithm name to a tuple (tid, cid) as\n"
+    "  returned by getObsArrays()\n",
+    "t_pos"_a, "t_time"_a, "t_pri"_a, "cbr"_a, "assigners"_a, "nthreads"_a=1,
+    "seed"_a=42);
+  m.def("getBestObs", &getBestObs,
+    "performs an assignment step several times with different seeds in\n"
+    "parallel and returns the best result; the visibility computation is\n"
+    "only done once\n"
+    "Args:\n"
+    "  t_pos   : 1D array of target x/y coordinates on the focal plane (in mm)\n"
+    "  t_time  : requested target observation times (in seconds)\n"
+    "  t_pri   : target priorities\n"
+    "  cbr     : structured array of cobras as generated by getAllCobrasArray()\n"
+    "  assigner: algorithm to do the assignment (see getAssigners()); only\n"
+    "            algorithms with random tie-breaking profit from several starts\n"
+    "  nstarts : number of assignments to perform\n"
+    "  score   : criterion for the best result: 'count' (number of observed\n"
+    "            targets), 'time' (total observation time of the observed\n"
+    "            targets) or 'priority' (number of observed targets of the\n"
+    "            highest priority, then of the next one, and so on)\n"
+    "  nthreads: number of threads (0: use all available hardware threads)\n"
+    "  seed    : seed of the first start; the others use seeds derived from it\n"
+    "Returns:\n"
+    "  a tuple (tid, cid) as getObsArrays()\n",
+    "t_pos"_a, "t_time"_a, "t_pri"_a, "cbr"_a, "assigner"_a, "nstarts"_a,
+    "score"_a="count", "nthreads"_a=1, "seed"_a=42);
+  py::class_<ETSContext>(m, "ETSContext",
+    "persistent setup for repeated assignments with the same cobras; the\n"
+    "cobra geometry and raster are computed only once, and the fiber/target\n"
+    "mappings are kept as long as the target positions do not change")
+    .def(py::init([](const cobra_array &cbr, size_t nthreads)
+      { return new ETSContext(array2cobras(cbr), nthreads); }),
+      "Args:\n"
+      "  cbr     : structured array of cobras as generated by\n"
+      "            getAllCobrasArray()\n"
+      "  nthreads: number of threads used for the computations\n"
+      "            (0: use all available hardware threads)\n",
+      "cbr"_a, "nthreads"_a=1)
+    .def("setTargets", &ctx_setTargets,
+      "sets the targets for the following assignments\n"
+      "Args:\n"
+      "  t_pos : 1D array of target x/y coordinates on the focal plane (in mm)\n"
+      "  t_time: requested target observation times (in seconds)\n"
+      "  t_pri : target priorities\n",
+      "t_pos"_a, "t_time"_a, "t_pri"_a)
+    .def("updateTargets", &ctx_updateTargets,
+      "changes the observation times and priorities of the current targets\n"
+      "without recomputing the mappings; targets removed by removeTargets()\n"
+      "stay removed (unlike with setTargets())\n"
+      "Args:\n"
+      "  t_time: requested target observation times (in seconds)\n"
+      "  t_pri : target priorities\n",
+      "t_time"_a, "t_pri"_a)
+    .def("addTargets", &ctx_addTargets,
+      "appends targets to the current target list; the new targets get the\n"
+      "indices following the last existing one\n"
+      "Args:\n"
+      "  t_pos : 1D array of target x/y coordinates on the focal plane (in mm)\n"
+      "  t_time: requested target observation times (in seconds)\n"
+      "  t_pri : target priorities\n",
+      "t_pos"_a, "t_time"_a, "t_pri"_a)
+    .def("removeTargets", &ctx_removeTargets,
+      "removes targets (e.g. completed ones) from the following assignments;\n"
+      "the indices of the other targets are not changed\n"
+      "Args:\n"
+      "  idx: list of target indices\n",
+      "idx"_a)
+    .def("getVis", &ctx_getVis,
+      "returns a dictionary mapping the indices of all visible targets to\n"
+      "the fibers that can observe them\n")
+    .def("getObs", &ctx_getObs,
+      "performs an assignment step for the current targets and returns a\n"
+      "tuple (tid, cid) as getObsArrays()\n"
+      "Args:\n"
+      "  assigner: algorithm to do the assignment (see getAssigners())\n"
+      "  seed    : seed for the random tie-breaking of some algorithms\n"
+      "  maxtime : if >0, time limit (in seconds) as for getObsArrays()\n"
+      "  maxiter : if >0, iteration limit as for getObsArrays()\n"
+      "  return_hit: if True, return (tid, cid, hit) as getObsArrays()\n",
+      "assigner"_a, "seed"_a=42, "maxtime"_a=0., "maxiter"_a=0,
+      "return_hit"_a=false)
+    .def("getObsIncremental", &ctx_getObsIncremental,
+      "like getObs(), but keeps the previous assignments of this algorithm\n"
+      "for all fibers not affected by the target changes since then\n"
+      "Args:\n"
+      "  assigner: algorithm to do the assignment (see getAssigners())\n"
+      "  maxdelta: if a larger fraction of the fibers is affected, a full\n"
+      "            assignment is done\n"
+      "  seed    : seed for the random tie-breaking of some algorithms\n",
+      "assigner"_a, "maxdelta"_a=0.25, "seed"_a=42)
+    .def("getBestObs", &ctx_getBestObs,
+      "like getObs(), but returns the best of several assignments with\n"
+      "different seeds, as the function getBestObs()\n"
+      "Args:\n"
+      "  assigner: algorithm to do the assignment (see getAssigners())\n"
+      "  nstarts : number of assignments to perform\n"
+      "  score   : 'count', 'time' or 'priority'\n"
+      "  seed    : seed of the first start\n",
+      "assigner"_a, "nstarts"_a, "score"_a="count", "seed"_a=42)
+    .def("compareAssigners", &ctx_compareAssigners,
+      "performs an assignment step for the current targets with several\n"
+      "algorithms and returns a dictionary as compareAssigners()\n"
+      "Args:\n"
+      "  assigners: list of algorithm names (see getAssigners())\n"
+      "  seed     : seed for the random tie-breaking of some algorithms\n",
+      "assigners"_a, "seed"_a=42);
+  m.def("getAssigners", &getAssigners,
+    "returns the names of all available assignment algorithms");
+  py::class_<PyStats>(m, "Stats",
+    "timings and event counts of the ETS computations, for tuning; use as\n"
+    "  with pyETS.Stats() as st:\n"
+    "      pyETS.getObsArrays(...)\n"
+    "  print(st.values())\n"
+    "Everything is zero unless the module was built with ETS_STATS set.\n"
+    "The tiles of planSurvey() computed by its worker threads are not\n"
+    "included.")
+    .def(py::init<>())
+    .def("__enter__", [](PyStats &st) -> PyStats & { st.enter(); return st; },
+      py::return_value_policy::reference)
+    .def("__exit__", [](PyStats &st, py::args) { st.exit(); })
+    .def("values", &PyStats::values,
+      "returns a dictionary with the counters 'queries', 'candidates',\n"
+      "'edges_removed', 'pqueue_sifts' and 'assignments' and the times\n"
+      "(in seconds) 'time_raster', 'time_mappings', 'time_inversion',\n"
+      "'time_cleanup', 'time_priority' and 'time_assign'\n");
+  m.def("statsEnabled", &ETSStats::enabled,
+    "returns True if the module was built with ETS_STATS set");
+  m.def("getCollidingPairs", &getCollidingPairs,
+    "returns all pairs of visible targets that are closer to each other than\n"
+    "a given distance\n"
+    "Args:\n"
+    "  t_pos  : 1D array of target x/y coordinates on the focal plane (in mm)\n"
+    "  offsets: visibility offsets as returned by getVisArrays(); target i is\n"
+    "           visible if offsets[i+1]>offsets[i]\n"
+    "  dist   : collision distance (in mm)\n"
+    "  nthreads: number of threads used for the computation\n"
+    "            (0: use all available hardware threads)\n"
+    "Returns:\n"
+    "  a tuple (i, j) of equally long arrays with i[k]<j[k]\n",
+    "t_pos"_a, "offsets"_a, "dist"_a, "nthreads"_a=1);
+  m.def("getElbowCollisions", &getElbowCollisions,
+    "returns, for every (target, cobra) combination of a visibility table,\n"
+    "the targets that are too close to the upper arm of the cobra and can be\n"
+    "observed by at least one other cobra\n"
+    "Args:\n"
+    "  t_pos    : 1D array of target x/y coordinates on the focal plane (in mm)\n"
+    "  offsets, cobra_idx, elbow: visibility table as returned by\n"
+    "             getVisArrays()\n"
+    "  dist     : collision distance (in mm)\n"
+    "  nthreads : number of threads used for the computation\n"
+    "             (0: use all available hardware threads)\n"
+    "Returns:\n"
+    "  a tuple (ofs, blocked): the targets blocked by the combination at\n"
+    "  index k of the visibility table are blocked[ofs[k]:ofs[k+1]]\n",
+    "t_pos"_a, "offsets"_a, "cobra_idx"_a, "elbow"_a, "dist"_a,
+    "nthreads"_a=1);
+  m.def("getTargetComponents", &getTargetComponents,
+    "splits targets into groups that can be assigned independently\n"
+    "Args:\n"
+    "  ntgt  : number of targets\n"
+    "  etgt  : 1D array of target indices of all possible observations\n"
+    "  egroup: 1D array of the same length; the cobra (and visit) number of\n"
+    "          every possible observation, e.g. ivisit*ncobra+icobra\n"
+    "  pi, pj: 1D arrays of equal length containing pairs of conflicting\n"
+    "          targets, e.g. as returned by getCollidingPairs()\n"
+    "Returns:\n"
+    "  a tuple (label, ncomp); label is an array with the component number\n"
+    "  (in [0; ncomp[) of every target, or -1 for targets without possible\n"
+    "  observations\n",
+    "ntgt"_a, "etgt"_a, "egroup"_a, "pi"_a, "pj"_a);
+  py::class_<TargetCatalog>(m, "TargetCatalog",
+    "memory-mapped binary target catalog as written by writeCatalog(); all\n"
+    "columns are read-only NumPy arrays sharing the memory of the mapping")
+    .def(py::init<const string &>(),
+      "Args:\n"
+      "  filename: name of the catalog file\n",
+      "filename"_a)
+    .def("__len__", &TargetCatalog::size)
+    .def_property_readonly("ids", &catalog_ids,
+      "target IDs (array of fixed-size byte strings)")
+    .def_property_readonly("ra", [](py::object self)
+      {
+      const auto &c(self.cast<const TargetCatalog &>());
+      return catalog_column(c.ra(), c.size(), self);
+      }, "right ascensions (in degrees)")
+    .def_property_readonly("dec", [](py::object self)
+      {
+      const auto &c(self.cast<const TargetCatalog &>());
+      return catalog_column(c.dec(), c.size(), self);
+      }, "declinations (in degrees)")
+    .def_property_readonly("time", [](py::object self)
+      {
+      const auto &c(self.cast<const TargetCatalog &>());
+      return catalog_column(c.time(), c.size(), self);
+      }, "requested observation times (in seconds)")
+    .def_property_readonly("pri", [](py::object self)
+      {
+      const auto &c(self.cast<const TargetCatalog &>());
+      return catalog_column(c.pri(), c.size(), self);
+      }, "target priorities")
+    .def_property_readonly("cls", [](py::object self)
+      {
+      const auto &c(self.cast<const TargetCatalog &>());
+      return catalog_column(c.cls(), c.size(), self);
+      }, "index of the class of every target in classes")
+    .def_property_readonly("classes", [](const TargetCatalog &c)
+      {
+      vector<string> res;
+      for (size_t i=0; i<c.nClasses(); ++i) res.push_back(c.className(i));
+      return res;
+      }, "class names: target classes of calibration targets, prefixes of\n"
+         "science targets")
+    .def_property_readonly("calib", [](const TargetCatalog &c)
+      {
+      vector<bool> res;
+      for (size_t i=0; i<c.nClasses(); ++i) res.push_back(c.isCalib(i));
+      return res;
+      }, "True for every class containing calibration targets");
+  py::class_<SkyIndex>(m, "SkyIndex",
+    "spatial index of sky positions, which quickly finds all positions\n"
+    "within a given angular distance of a pointing")
+    .def(py::init([](const double_array &ra, const double_array &dec,
+      double bandwidth)
+      {
+      planck_assert((ra.ndim()==1)&&(dec.ndim()==1),
+        "input arrays must be one-dimensional");
+      planck_assert(ra.shape(0)==dec.shape(0), "array size mismatch");
+      py::gil_scoped_release release;
+      return new SkyIndex(ra.data(), dec.data(), ra.shape(0), bandwidth);
+      }),
+      "Args:\n"
+      "  ra, dec  : 1D arrays of right ascensions and declinations (in degrees)\n"
+      "  bandwidth: height of the declination bands of the index (in degrees)\n",
+      "ra"_a, "dec"_a, "bandwidth"_a=0.5)
+    .def("__len__", &SkyIndex::size)
+    .def("query", [](const SkyIndex &idx, double ra, double dec, double radius)
+      {
+      vector<size_t> res;
+      {
+      py::gil_scoped_release release;
+      res=idx.query(ra, dec, radius);
+      }
+      return vec2array<size_t>(move(res));
+      },
+      "returns the indices of all positions within a given angular distance\n"
+      "Args:\n"
+      "  ra, dec: coordinates of the pointing (in degrees)\n"
+      "  radius : angular distance (in degrees)\n"
+      "Returns:\n"
+      "  an array of position indices, in ascending order\n",
+      "ra"_a, "dec"_a, "radius"_a);
+  m.def("planSurvey", &planSurvey,
+    "plans a survey by assigning the targets of a sequence of pointings, where\n"
+    "every tile only sees the time still missing after all earlier tiles\n"
+    "overlapping it; tiles that do not overlap are processed in parallel\n"
+    "Args:\n"
+    "  ra, dec   : target coordinates (in degrees)\n"
+    "  time      : requested target observation times (in seconds)\n"
+    "  pri       : target priorities\n"
+    "  pointings : array of shape (n,4) with the ra, dec and position angle\n"
+    "              (in degrees) and the exposure time (in seconds) of every tile\n"
+    "  cbr       : structured array of cobras as generated by getAllCobrasArray()\n"
+    "  assigner  : algorithm to do the assignment (see getAssigners())\n"
+    "  projection: either a plate scale (in mm per degree) for a simple tangent\n"
+    "              plane projection, or a callable projection(pointing, ra, dec)\n"
+    "              receiving a pointing row as a tuple and returning the complex\n"
+    "              focal plane positions (in mm)\n"
+    "  callback  : if not None, callback(tile, tid, cid) is called for every\n"
+    "              tile in order as soon as it is finished\n"
+    "  radius    : radius of the field of view (in degrees)\n"
+    "  nthreads  : number of threads (0: use all available hardware threads)\n"
+    "  maxactive : maximum number of started but unreported tiles (0: twice\n"
+    "              the number of threads)\n"
+    "  seed      : seed for the random tie-breaking; tile k uses seed+k\n"
+    "Returns:\n"
+    "  a tuple (remaining, results): the observation times still missing, and\n"
+    "  a list with a tuple (tid, cid) of target and cobra indices for every\n"
+    "  tile (None if a callback is given)\n",
+    "ra"_a, "dec"_a, "time"_a, "pri"_a, "pointings"_a, "cbr"_a, "assigner"_a,
+    "projection"_a, "callback"_a=py::none(), "radius"_a=0.75, "nthreads"_a=1,
+    "maxactive"_a=0, "seed"_a=42);
+  m.def("writeCatalog", &writeCatalog,
+    "writes a binary target catalog that can be opened with TargetCatalog\n"
+    "Args:\n"
+    "  filename: name of the catalog file\n"
+    "  ids     : list of target IDs\n"
+    "  ra, dec : target coordinates (in degrees)\n"
+    "  time    : requested observation times (in seconds)\n"
+    "  pri     : target priorities\n"
+    "  cls     : index of the class of every target in classes\n"
+    "  classes : class names (the prefix for science targets)\n"
+    "  calib   : True for every class containing calibration targets\n",
+    "filename"_a, "ids"_a, "ra"_a, "dec"_a, "time"_a, "pri"_a, "cls"_a,
+    "classes"_a, "calib"_a);
+  m.def("getAllCobrasArray", &getAllCobrasArray,
+    "returns the cobras of an idealized instrument configuration (see\n"
+    "getAllCobras()) as a NumPy structured array with the fields 'center',\n"
+    "'l1', 'l2', 'dotpos' and 'rdot'");
   m.def("getAllCobras", &getAllCobras,
     "returns a list containing the parameters of all cobras of an idealized \n"
     " instrument configuration. The parameters are in turn stored as\n"
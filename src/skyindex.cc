@@ -0,0 +1,99 @@
+#include <cmath>
+#include <numeric>
+#include <algorithm>
+#include "skyindex.h"
+#include "error_handling.h"
+
+using namespace std;
+
+namespace {
+
+constexpr double pi=3.141592653589793238462643383279502884197;
+constexpr double halfpi=0.5*pi, twopi=2*pi, degr2rad=pi/180.;
+
+/*! Returns \a ra (in degrees) in radians, mapped to [0; 2pi[. */
+inline double norm_ra (double ra)
+  {
+  double res=fmod(ra,360.);
+  if (res<0) res+=360.;
+  return min(res*degr2rad, twopi); // guard against rounding to 2pi+eps
+  }
+
+} // unnamed namespace
+
+SkyIndex::SkyIndex (const double *ra, const double *dec, size_t n,
+  double bandwidth_)
+  : bandwidth(bandwidth_*degr2rad)
+  {
+  planck_assert(bandwidth_>0, "band width must be positive");
+  size_t nband=max<size_t>(1,size_t(ceil(pi/bandwidth)));
+  vector<size_t> band(n);
+  vector<double> r(n), d(n);
+  for (size_t i=0; i<n; ++i)
+    {
+    planck_assert(abs(dec[i])<=90., "bad declination");
+    planck_assert(std::isfinite(ra[i]), "bad right ascension");
+    r[i]=norm_ra(ra[i]);
+    d[i]=dec[i]*degr2rad;
+    band[i]=min(nband-1, size_t((d[i]+halfpi)/bandwidth));
+    }
+  idx.resize(n);
+  iota(idx.begin(), idx.end(), 0);
+  sort(idx.begin(), idx.end(), [&](size_t a, size_t b)
+    {
+    if (band[a]!=band[b]) return band[a]<band[b];
+    if (r[a]!=r[b]) return r[a]<r[b];
+    return a<b;
+    });
+  ofs.assign(nband+1,0);
+  for (auto b : band) ++ofs[b+1];
+  for (size_t b=0; b<nband; ++b) ofs[b+1]+=ofs[b];
+  sra.resize(n);
+  sdec.resize(n);
+  for (size_t k=0; k<n; ++k)
+    { sra[k]=r[idx[k]]; sdec[k]=d[idx[k]]; }
+  }
+
+vector<size_t> SkyIndex::query (double ra, double dec, double radius) const
+  {
+  vector<size_t> res;
+  double rad=min(radius*degr2rad, pi), a0=norm_ra(ra), d0=dec*degr2rad;
+  double dlo=max(-halfpi, d0-rad), dhi=min(halfpi, d0+rad);
+  if (idx.empty() || (rad<0) || (dlo>dhi)) return res;
+  size_t nband=ofs.size()-1;
+  size_t blo=min(nband-1, size_t((dlo+halfpi)/bandwidth)),
+         bhi=min(nband-1, size_t((dhi+halfpi)/bandwidth));
+  // half width of the RA window; all RAs if the circle contains a pole
+  double dra=pi;
+  if ((d0+rad<halfpi) && (d0-rad>-halfpi))
+    {
+    double s=sin(rad)/cos(d0);
+    if (s<1.) dra=asin(s)*(1.+1e-12)+1e-15;
+    }
+  // haversine test of the angular distance
+  double hs=sin(0.5*rad), hs2=hs*hs, cd0=cos(d0);
+  auto scan=[&](size_t lo, size_t hi, double alo, double ahi)
+    {
+    auto first=lower_bound(sra.begin()+lo, sra.begin()+hi, alo),
+         last=upper_bound(first, sra.begin()+hi, ahi);
+    for (size_t k=first-sra.begin(); k<size_t(last-sra.begin()); ++k)
+      {
+      double sd=sin(0.5*(sdec[k]-d0)), sa=sin(0.5*(sra[k]-a0));
+      if (sd*sd+cd0*cos(sdec[k])*sa*sa<=hs2) res.push_back(idx[k]);
+      }
+    };
+  for (size_t b=blo; b<=bhi; ++b)
+    {
+    size_t lo=ofs[b], hi=ofs[b+1];
+    if (dra>=pi)
+      scan(lo, hi, 0., twopi);
+    else if (a0-dra<0.)
+      { scan(lo, hi, 0., a0+dra); scan(lo, hi, a0-dra+twopi, twopi); }
+    else if (a0+dra>twopi)
+      { scan(lo, hi, 0., a0+dra-twopi); scan(lo, hi, a0-dra, twopi); }
+    else
+      scan(lo, hi, a0-dra, a0+dra);
+    }
+  sort(res.begin(), res.end());
+  return res;
+  }
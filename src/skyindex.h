@@ -0,0 +1,56 @@
+/*
+ *  This file is part of ets_fiber_assigner.
+ *
+ *  ets_fiber_assigner is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ets_fiber_assigner is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ets_fiber_assigner; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ *  ets_fiber_assigner is being developed at the Max-Planck-Institut fuer
+ *  Astrophysik.
+ */
+
+#ifndef ETS_SKYINDEX_H
+#define ETS_SKYINDEX_H
+
+#include <cstddef>
+#include <vector>
+
+/*! Spatial index of positions on the sphere, which finds all positions
+    within a given angular distance of a pointing.
+    The sphere is divided into declination bands, and the positions of
+    every band are sorted by right ascension, so that a query only looks at
+    the positions in a narrow RA window of the few bands it overlaps.
+    All angles are given in degrees. */
+class SkyIndex
+  {
+  private:
+    double bandwidth; // in radians
+    std::vector<size_t> ofs; // positions of band i: [ofs[i]; ofs[i+1][
+    std::vector<size_t> idx; // input index, sorted by band and RA
+    std::vector<double> sra, sdec; // RA and Dec (in radians), in idx order
+
+  public:
+    /*! Builds the index for the \a n positions \a ra, \a dec, using bands
+        of \a bandwidth_ degrees. */
+    SkyIndex (const double *ra, const double *dec, size_t n,
+      double bandwidth_=0.5);
+
+    size_t size() const { return idx.size(); }
+    /*! Returns the indices of all positions whose angular distance from
+        (\a ra, \a dec) is at most \a radius, in ascending order. */
+    std::vector<size_t> query (double ra, double dec, double radius) const;
+  };
+
+#endif